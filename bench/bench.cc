@@ -0,0 +1,292 @@
+/* Benchmark driver. For every workload in ``corpus.hh'', we generate a corpus
+ * and time how long it takes to parse, navigate, serialize and destroy it.
+ * Each workload runs in a child process of its own, so the peak RSS that we
+ * report belongs to that workload alone.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <numeric>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.hh"
+
+static const char* usage =
+    "usage: %s [-m] [-s MiB] [-r reps] [-S seed] [-o file] [-b file "
+    "[-t percent]]\n"
+    "          [workload...]\n"
+    "  -m  time the parser's stages instead of the workloads\n"
+    "  -s  approximate size of each corpus (default 16)\n"
+    "  -r  repetitions per workload, the best one counts (default 5)\n"
+    "  -S  seed for the corpus generators (default 42)\n"
+    "  -o  write the results to a file\n"
+    "  -b  compare the results to those in a file written by -o\n"
+    "  -t  how much slower than the baseline is too slow (default 10)\n";
+
+// What a child hands back to the driver. Times are the best of all runs.
+struct Result {
+    size_t bytes     = 0;
+    size_t docs      = 0;
+    size_t nodes     = 0;
+    size_t lookups   = 0;
+    size_t out_bytes = 0;
+    size_t memory    = 0;
+    double parse     = 0;
+    double navigate  = 0;
+    double serialize = 0;
+    double destroy   = 0;
+};
+
+double bench::since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static FILE* open_doc(std::string_view doc)
+{
+    FILE* stream = fmemopen(const_cast<char*>(doc.data()), doc.size(), "r");
+    if (!stream) {
+        perror("fmemopen");
+        exit(1);
+    }
+    return stream;
+}
+
+/* Streams are opened as we go, that's part of what a user of SJP::PARSER
+ * has to pay for.
+ */
+std::vector<sjp::Json> bench::parse(const Corpus& corpus,
+                                    const io::Logger& logger,
+                                    sjp::ParseStats* stats, size_t* nodes)
+{
+    std::vector<sjp::Json> docs {};
+    docs.reserve(corpus.count());
+
+    FILE*       stream = open_doc(corpus.doc(0));
+    sjp::Parser parser { stream, &logger };
+    parser.set_stats(stats);
+
+    for (size_t i = 0; i < corpus.count(); i++) {
+        if (i) {
+            fclose(stream);
+            parser.reset(stream = open_doc(corpus.doc(i)));
+        }
+        docs.push_back(parser.parse());
+        if (stats && nodes)
+            *nodes += std::accumulate(stats->nodes.begin(),
+                                      stats->nodes.end(), size_t(0));
+    }
+    fclose(stream);
+    return docs;
+}
+
+static Result run(const bench::Workload& w, const bench::Options& opts)
+{
+    io::NullLogger logger {};
+    bench::Corpus  corpus {};
+    Result         res {};
+
+    w.generate(corpus, opts.size, opts.seed);
+    res.bytes = corpus.size();
+    res.docs  = corpus.count();
+
+    // A first, untimed parse tells us what the corpus consists of.
+    {
+        sjp::ParseStats stats {};
+        auto docs = bench::parse(corpus, logger, &stats, &res.nodes);
+        for (const auto& doc : docs) res.memory += doc.memory_usage();
+    }
+
+    double sink = 0;
+    for (size_t rep = 0; rep < opts.reps; rep++) {
+        auto best = [rep](double& best, double t) {
+            best = rep ? std::min(best, t) : t;
+        };
+
+        bench::Clock::time_point start = bench::Clock::now();
+        auto docs = bench::parse(corpus, logger);
+        best(res.parse, bench::since(start));
+
+        start = bench::Clock::now();
+        res.lookups = 0;
+        for (const auto& doc : docs) res.lookups += w.navigate(doc, sink);
+        best(res.navigate, bench::since(start));
+
+        start = bench::Clock::now();
+        res.out_bytes = 0;
+        for (const auto& doc : docs) res.out_bytes += doc.to_string().size();
+        best(res.serialize, bench::since(start));
+
+        start = bench::Clock::now();
+        docs.clear();
+        best(res.destroy, bench::since(start));
+    }
+
+    // Keeps the navigation from being optimized away.
+    if (sink == 42.0) fputc(' ', stderr);
+    return res;
+}
+
+static void print_header(void)
+{
+    printf("%-8s %7s %7s %9s %8s %7s %9s %8s %8s %7s %7s\n",
+           "workload", "MiB", "docs", "nodes", "parse", "parse",
+           "navigate", "write", "destroy", "memory", "RSS");
+    printf("%-8s %7s %7s %9s %8s %7s %9s %8s %8s %7s %7s\n",
+           "", "", "", "", "MB/s", "ns/node", "ns/op", "MB/s", "ns/node",
+           "ratio", "MiB");
+}
+
+static void print_result(const char* name, const Result& res, long rss_kib)
+{
+    const double nodes = static_cast<double>(std::max<size_t>(res.nodes, 1));
+    const double ops   = static_cast<double>(std::max<size_t>(res.lookups, 1));
+
+    printf("%-8s %7.1f %7zu %9zu %8.1f %7.1f %9.1f %8.1f %8.1f %7.1f %7.1f\n",
+           name, static_cast<double>(res.bytes) / (1 << 20), res.docs,
+           res.nodes, static_cast<double>(res.bytes) / 1e6 / res.parse,
+           res.parse * 1e9 / nodes, res.navigate * 1e9 / ops,
+           static_cast<double>(res.out_bytes) / 1e6 / res.serialize,
+           res.destroy * 1e9 / nodes,
+           static_cast<double>(res.memory) / static_cast<double>(res.bytes),
+           static_cast<double>(rss_kib) / 1024);
+    fflush(stdout);
+}
+
+// All times per unit, which is what goes into a results file.
+static void add_measurements(std::vector<bench::Measurement>& out,
+                             const char* name, const Result& res)
+{
+    const double nodes = static_cast<double>(std::max<size_t>(res.nodes, 1));
+    const double ops   = static_cast<double>(std::max<size_t>(res.lookups, 1));
+    const double bytes = static_cast<double>(std::max<size_t>(res.out_bytes,
+                                                              1));
+    std::string n { name };
+
+    out.push_back({ n + ".parse",     res.parse * 1e9 / nodes,     "ns/node" });
+    out.push_back({ n + ".navigate",  res.navigate * 1e9 / ops,    "ns/op"   });
+    out.push_back({ n + ".serialize", res.serialize * 1e9 / bytes, "ns/byte" });
+    out.push_back({ n + ".destroy",   res.destroy * 1e9 / nodes,   "ns/node" });
+}
+
+/* The child writes its result into a pipe and exits. WAIT4 then tells us how
+ * much memory it needed at most.
+ */
+static bool fork_run(const bench::Workload& w, const bench::Options& opts,
+                     std::vector<bench::Measurement>& out)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return false;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        Result res = run(w, opts);
+        ssize_t n  = write(fds[1], &res, sizeof(res));
+        _exit(n == sizeof(res) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    Result  res {};
+    ssize_t n = read(fds[0], &res, sizeof(res));
+    close(fds[0]);
+
+    int           status = 0;
+    struct rusage usage  {};
+    wait4(pid, &status, 0, &usage);
+    if (n != sizeof(res) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "workload `%s' failed\n", w.name);
+        return false;
+    }
+
+    print_result(w.name, res, usage.ru_maxrss);
+    add_measurements(out, w.name, res);
+    return true;
+}
+
+static bool run_workloads(int argc, char** argv, const bench::Options& opts,
+                          std::vector<bench::Measurement>& out)
+{
+    // Without any names, all workloads are run.
+    std::vector<const bench::Workload*> selected {};
+    for (const auto& w : bench::workloads) {
+        bool wanted = optind == argc;
+        for (int i = optind; i < argc; i++)
+            wanted |= strcmp(argv[i], w.name) == 0;
+        if (wanted) selected.push_back(&w);
+    }
+    if (selected.empty()) {
+        fprintf(stderr, "no such workload, try one of:\n");
+        for (const auto& w : bench::workloads)
+            fprintf(stderr, "  %-8s %s\n", w.name, w.description);
+        return false;
+    }
+
+    printf("corpora of ~%zu MiB, best of %zu runs, seed %lu\n",
+           opts.size >> 20, opts.reps, opts.seed);
+    print_header();
+
+    bool ok = true;
+    for (const auto* w : selected) ok &= fork_run(*w, opts, out);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    bench::Options opts {};
+
+    int opt;
+    while ((opt = getopt(argc, argv, "ms:r:S:o:b:t:h")) != -1) {
+        switch (opt) {
+        case 'm': opts.micro     = true;                             break;
+        case 's': opts.size      = strtoul(optarg, nullptr, 10) << 20; break;
+        case 'r': opts.reps      = strtoul(optarg, nullptr, 10);     break;
+        case 'S': opts.seed      = strtoull(optarg, nullptr, 10);    break;
+        case 'o': opts.output    = optarg;                           break;
+        case 'b': opts.baseline  = optarg;                           break;
+        case 't': opts.threshold = strtod(optarg, nullptr);          break;
+        default:
+            fprintf(stderr, usage, *argv);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (opts.size == 0 || opts.reps == 0 || opts.threshold <= 0) {
+        fprintf(stderr, usage, *argv);
+        return 1;
+    }
+
+    std::vector<bench::Measurement> results {};
+    bool ok = true;
+    if (opts.micro) results = bench::micro(opts);
+    else            ok = run_workloads(argc, argv, opts, results);
+
+    if (opts.output && !bench::write_results(opts.output, results))
+        ok = false;
+    if (opts.baseline && !bench::compare(opts.baseline, results,
+                                         opts.threshold))
+        ok = false;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+/* What the benchmark driver's parts share: options, timing, parsing a corpus
+ * and the results that can be written to and compared against a file.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef _BENCH_HH_
+#define _BENCH_HH_
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "common.hh"
+#include "corpus.hh"
+#include "io.hh"
+#include "sjp.hh"
+
+namespace bench {
+    struct Options;
+    struct Measurement;
+
+    using Clock = std::chrono::steady_clock;
+
+    // Seconds that passed since START.
+    double since(Clock::time_point start);
+
+    /* Parses every document of CORPUS. If STATS is given, NODES is increased
+     * by the number of nodes that were built.
+     */
+    std::vector<sjp::Json> parse(const Corpus&, const io::Logger&,
+                                 sjp::ParseStats* stats = nullptr,
+                                 size_t* nodes = nullptr);
+
+    // Times the parser's stages one by one, see ``micro.cc''.
+    std::vector<Measurement> micro(const Options&);
+
+    /* Results files have one measurement per line: name, value and unit,
+     * separated by tabs. Lines starting with `#' are comments.
+     */
+    bool write_results(const char* path, const std::vector<Measurement>&);
+
+    /* Prints how every measurement compares to the one of the same name in
+     * BASELINE. Returns false if the file can't be read or any of them got
+     * slower by more than THRESHOLD percent.
+     */
+    bool compare(const char* baseline, const std::vector<Measurement>&,
+                 double threshold);
+}
+
+struct bench::Options {
+    size_t      size      = 16 << 20;
+    size_t      reps      = 5;
+    uint64_t    seed      = 42;
+    bool        micro     = false;
+    const char* output    = nullptr;
+    const char* baseline  = nullptr;
+    double      threshold = 10;
+};
+
+// All values are times per UNIT, i.e. smaller is better.
+struct bench::Measurement {
+    std::string name  = {};
+    double      value = 0;
+    std::string unit  = {};
+};
+
+#endif /* _BENCH_HH_ */
@@ -0,0 +1,326 @@
+/* Generators and navigators for the benchmark corpora, see ``corpus.hh''.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <charconv>
+
+#include "corpus.hh"
+#include "kernels.hh"
+
+// Includes some multi-byte UTF-8, which real text usually has a bit of.
+static const char* words[] = {
+    "the", "of", "and", "to", "in", "is", "you", "that", "it", "he", "was",
+    "for", "on", "are", "as", "with", "his", "they", "at", "be", "this",
+    "have", "from", "or", "one", "had", "by", "word", "but", "not", "what",
+    "json", "parser", "fast", "release", "today", "coffee", "weekend",
+    "café", "naïve", "über", "東京", "日本語", "🚀", "👍",
+};
+static constexpr size_t NWORDS = sizeof(words) / sizeof(*words);
+
+static void put_int(std::string& s, int64_t n)
+{
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), n);
+    s.append(buf, res.ptr);
+}
+
+static void put_fixed(std::string& s, double d, int precision)
+{
+    char buf[64];
+    auto res = std::to_chars(buf, buf + sizeof(buf), d,
+                             std::chars_format::fixed, precision);
+    s.append(buf, res.ptr);
+}
+
+static void put_words(std::string& s, bench::Rng& rng, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (i) s += ' ';
+        s += words[rng.below(NWORDS)];
+    }
+}
+
+static void put_name(std::string& s, bench::Rng& rng)
+{
+    s += '"';
+    put_words(s, rng, 1 + rng.below(2));
+    s += '_';
+    put_int(s, static_cast<int64_t>(rng.below(10000)));
+    s += '"';
+}
+
+/* Opens the root array of single-document corpora, ITEM adds one element at
+ * a time until we're past SIZE.
+ */
+template <typename F>
+static void array_of(bench::Corpus& c, size_t size, F item)
+{
+    c.text.reserve(size + size / 8);
+    c.text += '[';
+    for (bool first = true; c.text.size() < size; first = false) {
+        if (!first) c.text += ',';
+        item(c.text);
+    }
+    c.text += ']';
+    c.ends.push_back(c.text.size());
+}
+
+// What a response of a social network's timeline looks like.
+static void tweets(bench::Corpus& c, size_t size, uint64_t seed)
+{
+    bench::Rng rng { seed };
+    int64_t    id = 1050118621198921728;
+
+    array_of(c, size, [&rng, &id](std::string& s) {
+        id += static_cast<int64_t>(rng.below(1000000));
+        s += "{\"id\":";             put_int(s, id);
+        s += ",\"id_str\":\"";       put_int(s, id);
+        s += "\",\"created_at\":\"Mon Oct 16 12:";
+        put_int(s, static_cast<int64_t>(10 + rng.below(50)));
+        s += ":00 +0000 2026\",\"text\":\"";
+        put_words(s, rng, 5 + rng.below(25));
+        s += "\",\"user\":{\"id\":";
+        put_int(s, static_cast<int64_t>(rng.below(1000000000)));
+        s += ",\"name\":";           put_name(s, rng);
+        s += ",\"screen_name\":";    put_name(s, rng);
+        s += ",\"description\":\"";  put_words(s, rng, rng.below(12));
+        s += "\",\"followers_count\":";
+        put_int(s, static_cast<int64_t>(rng.below(100000)));
+        s += ",\"verified\":";       s += rng.chance(5) ? "true" : "false";
+        s += "},\"entities\":{\"hashtags\":[";
+        for (size_t i = 0, n = rng.below(4); i < n; i++) {
+            if (i) s += ',';
+            put_name(s, rng);
+        }
+        s += "],\"user_mentions\":[]},\"retweet_count\":";
+        put_int(s, static_cast<int64_t>(rng.below(5000)));
+        s += ",\"favorite_count\":";
+        put_int(s, static_cast<int64_t>(rng.below(20000)));
+        s += ",\"favorited\":false,\"lang\":\"en\",\"in_reply_to_status_id\":";
+        if (rng.chance(30)) put_int(s, id - 1);
+        else                s += "null";
+        s += '}';
+    });
+}
+
+static size_t tweets_nav(const sjp::Json& json, double& sink)
+{
+    const sjp::JsonValue& root { json.get_root() };
+    for (size_t i = 0; i < root.size(); i++) {
+        const sjp::JsonValue& tweet { root[i] };
+        const sjp::JsonValue& text  { tweet["text"] };
+
+        sink += tweet["user"]["followers_count"].get_number().value_or(0);
+        sink += tweet["retweet_count"].get_number().value_or(0);
+        sink += tweet["entities"]["hashtags"].size();
+        if (text.get_type() == sjp::Type::String)
+            sink += static_cast<const sjp::JsonString&>(text).value.size();
+    }
+    return 6 * root.size();
+}
+
+// Country borders, i.e. a few long lists of [lon, lat] pairs.
+static void geojson(bench::Corpus& c, size_t size, uint64_t seed)
+{
+    bench::Rng rng { seed };
+
+    c.text.reserve(size + size / 8);
+    c.text += "{\"type\":\"FeatureCollection\",\"features\":[";
+    for (bool first = true; c.text.size() < size; first = false) {
+        std::string& s = c.text;
+        if (!first) s += ',';
+
+        s += "{\"type\":\"Feature\",\"properties\":{\"name\":";
+        put_name(s, rng);
+        s += ",\"population\":";
+        put_int(s, static_cast<int64_t>(rng.below(100000000)));
+        s += "},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[[";
+
+        double lon0 = rng.uniform(-170, 170), lat0 = rng.uniform(-80, 80);
+        double lon = lon0, lat = lat0;
+        for (size_t i = 0, n = 50 + rng.below(500); i <= n; i++) {
+            if (i) s += ',';
+            if (i == n) lon = lon0, lat = lat0; // rings are closed
+            s += '[';  put_fixed(s, lon, 6);
+            s += ','; put_fixed(s, lat, 6);
+            s += ']';
+            lon += rng.uniform(-0.01, 0.01);
+            lat += rng.uniform(-0.01, 0.01);
+        }
+        s += "]]}}";
+    }
+    c.text += "]}";
+    c.ends.push_back(c.text.size());
+}
+
+static size_t geojson_nav(const sjp::Json& json, double& sink)
+{
+    const sjp::JsonValue& features { json["features"] };
+    size_t n = 0;
+
+    for (size_t i = 0; i < features.size(); i++) {
+        const sjp::JsonValue& geometry { features[i]["geometry"] };
+        const sjp::JsonValue& ring     { geometry["coordinates"][0] };
+        for (size_t j = 0; j < ring.size(); j++) {
+            auto point = ring[j].get_numbers();
+            if (point && point->size() == 2) sink += (*point)[0] - (*point)[1];
+        }
+        n += 4 + ring.size();
+    }
+    return n;
+}
+
+// Service configuration that's nested a dozen levels deep or more.
+static void config(std::string& s, bench::Rng& rng, size_t depth)
+{
+    s += "{\"name\":";     put_name(s, rng);
+    s += ",\"enabled\":"; s += rng.chance(80) ? "true" : "false";
+    s += ",\"value\":";   put_int(s, static_cast<int64_t>(rng.below(1000)));
+    s += ",\"options\":{\"retries\":";
+    put_int(s, static_cast<int64_t>(rng.below(10)));
+    s += ",\"timeout\":";  put_fixed(s, rng.uniform(0, 30), 1);
+    s += ",\"tags\":[\"a\",\"b\"],\"fallback\":null}";
+    if (depth) {
+        s += ",\"child\":";
+        config(s, rng, depth - 1);
+    }
+    s += '}';
+}
+
+static void configs(bench::Corpus& c, size_t size, uint64_t seed)
+{
+    bench::Rng rng { seed };
+
+    array_of(c, size, [&rng](std::string& s) {
+        config(s, rng, 8 + rng.below(40));
+    });
+}
+
+static size_t configs_nav(const sjp::Json& json, double& sink)
+{
+    const sjp::JsonValue& root { json.get_root() };
+    size_t n = 0;
+
+    for (size_t i = 0; i < root.size(); i++) {
+        for (const sjp::JsonValue* v = &root[i];
+             v->get_type() == sjp::Type::Object; v = &(*v)["child"]) {
+            sink += (*v)["value"].get_number().value_or(0);
+            sink += (*v)["options"]["timeout"].get_number().value_or(0);
+            n += 4;
+        }
+    }
+    return n;
+}
+
+// A long list of 64 bit database keys, all of which fit into a double.
+static void ids(bench::Corpus& c, size_t size, uint64_t seed)
+{
+    bench::Rng rng { seed };
+
+    array_of(c, size, [&rng](std::string& s) {
+        put_int(s, static_cast<int64_t>(rng.next() >> (11 + rng.below(32))));
+    });
+}
+
+static size_t ids_nav(const sjp::Json& json, double& sink)
+{
+    sink += sjp::sum(json.get_root());
+    return sjp::count(json.get_root());
+}
+
+// Strings that are mostly escapes, like embedded source code or markup.
+static void escapes(bench::Corpus& c, size_t size, uint64_t seed)
+{
+    static const char* escs[] = {
+        "\\\"", "\\\\", "\\/", "\\b", "\\f", "\\n", "\\r", "\\t",
+        "\\u00e9", "\\u2603", "\\ud83d\\ude80",
+    };
+    static constexpr size_t NESCS = sizeof(escs) / sizeof(*escs);
+    bench::Rng rng { seed };
+
+    array_of(c, size, [&rng](std::string& s) {
+        s += '"';
+        for (size_t i = 0, n = 4 + rng.below(60); i < n; i++) {
+            if (rng.chance(40)) s += words[rng.below(NWORDS)];
+            else                s += escs[rng.below(NESCS)];
+        }
+        s += '"';
+    });
+}
+
+static size_t escapes_nav(const sjp::Json& json, double& sink)
+{
+    const sjp::JsonValue& root { json.get_root() };
+    for (size_t i = 0; i < root.size(); i++) {
+        const sjp::JsonValue& v { root[i] };
+        if (v.get_type() == sjp::Type::String)
+            sink += static_cast<const sjp::JsonString&>(v).value.size();
+    }
+    return root.size();
+}
+
+// Structured logs, one small document per line.
+static void ndjson(bench::Corpus& c, size_t size, uint64_t seed)
+{
+    static const char* levels[] = { "debug", "info", "info", "warn", "error" };
+    static const char* paths[]  = {
+        "/api/v1/users", "/api/v1/orders", "/health", "/login", "/static/app.js"
+    };
+    bench::Rng rng { seed };
+
+    c.text.reserve(size + size / 8);
+    while (c.text.size() < size) {
+        std::string& s = c.text;
+
+        s += "{\"ts\":\"2026-10-16T12:";
+        put_int(s, static_cast<int64_t>(10 + rng.below(50)));
+        s += ":";
+        put_int(s, static_cast<int64_t>(10 + rng.below(50)));
+        s += ".";
+        put_int(s, static_cast<int64_t>(100 + rng.below(900)));
+        s += "Z\",\"level\":\"";   s += levels[rng.below(5)];
+        s += "\",\"msg\":\"";      put_words(s, rng, 3 + rng.below(10));
+        s += "\",\"req_id\":\"";
+        put_int(s, static_cast<int64_t>(rng.next() >> 12));
+        s += "\",\"method\":\"";   s += rng.chance(70) ? "GET" : "POST";
+        s += "\",\"path\":\"";     s += paths[rng.below(5)];
+        s += "\",\"status\":";
+        put_int(s, rng.chance(90) ? 200
+                                  : static_cast<int64_t>(500 + rng.below(4)));
+        s += ",\"latency_ms\":";   put_fixed(s, rng.uniform(0.1, 900), 3);
+        s += ",\"cached\":";       s += rng.chance(20) ? "true" : "false";
+        s += "}";
+        c.ends.push_back(c.text.size());
+        s += '\n';
+    }
+}
+
+static size_t ndjson_nav(const sjp::Json& json, double& sink)
+{
+    sink += json["status"].get_number().value_or(0);
+    sink += json["latency_ms"].get_number().value_or(0);
+    sink += json["level"].get_type() == sjp::Type::String;
+    return 3;
+}
+
+const std::vector<bench::Workload> bench::workloads = {
+    { "tweets",  "string-heavy objects",        tweets,  tweets_nav  },
+    { "geojson", "float coordinate arrays",     geojson, geojson_nav },
+    { "configs", "deeply nested objects",       configs, configs_nav },
+    { "ids",     "integer IDs",                 ids,     ids_nav     },
+    { "escapes", "escape-heavy strings",        escapes, escapes_nav },
+    { "ndjson",  "log lines, one document each", ndjson, ndjson_nav  },
+};
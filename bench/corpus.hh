@@ -0,0 +1,92 @@
+/* Synthetic corpora for the benchmark driver. Each one mimics the shape of a
+ * well-known kind of JSON, and the same seed always gives the same bytes, so
+ * numbers from different builds can be compared.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef _CORPUS_HH_
+#define _CORPUS_HH_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.hh"
+#include "sjp.hh"
+
+namespace bench {
+    struct Rng;
+    struct Corpus;
+
+    /* Every generator writes documents until the corpus holds roughly SIZE
+     * bytes. Only the NDJSON corpus has more than one of them.
+     */
+    using Generator = void (*)(Corpus&, size_t size, uint64_t seed);
+
+    /* Does the kind of lookups an application would do on one document of
+     * the corpus and returns how many values it looked at. The result is
+     * folded into SINK, so that the compiler can't drop the work.
+     */
+    using Navigator = size_t (*)(const sjp::Json&, double& sink);
+
+    struct Workload {
+        const char* name;
+        const char* description;
+        Generator   generate;
+        Navigator   navigate;
+    };
+
+    extern const std::vector<Workload> workloads;
+}
+
+/* SplitMix64. It's tiny, fast and good enough for making up data. Above all,
+ * it gives the same sequence on every platform, which RAND doesn't.
+ */
+struct bench::Rng {
+    uint64_t state;
+
+    uint64_t next(void)
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    size_t below(size_t n) { return next() % n; }
+    bool   chance(size_t percent) { return below(100) < percent; }
+    double uniform(double lo, double hi)
+    { return lo + (hi - lo) * (static_cast<double>(next() >> 11) * 0x1p-53); }
+};
+
+/* All documents of a corpus are kept in TEXT, one after the other. ENDS has
+ * the offset right past each of them.
+ */
+struct bench::Corpus {
+    std::string         text = {};
+    std::vector<size_t> ends = {};
+
+    size_t size(void) const  { return text.size(); }
+    size_t count(void) const { return ends.size(); }
+
+    std::string_view doc(size_t i) const
+    {
+        size_t begin = i ? ends[i-1] : 0;
+        return std::string_view { text.data() + begin, ends[i] - begin };
+    }
+};
+
+#endif /* _CORPUS_HH_ */
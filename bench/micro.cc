@@ -0,0 +1,257 @@
+/* Microbenchmarks for the parser's stages. SJP::PARSER doesn't expose its
+ * stages, so each of them gets an input that consists of almost nothing but
+ * what the stage handles, e.g. a huge run of whitespace for `ws'. Everything
+ * else (the tree's stages) is timed directly.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <utility>
+
+#include "bench.hh"
+
+/* Best time of REPS runs of F. AFTER is called after each run, but isn't
+ * timed, which is where the results of F can be freed.
+ */
+template <typename F, typename G>
+static double best_of(size_t reps, F f, G after)
+{
+    double best = 0;
+    for (size_t i = 0; i < reps; i++) {
+        bench::Clock::time_point start = bench::Clock::now();
+        f();
+        double t = bench::since(start);
+        after();
+        if (i == 0 || t < best) best = t;
+    }
+    return best;
+}
+
+static bench::Corpus make_corpus(std::string&& text)
+{
+    bench::Corpus c {};
+    c.text = std::move(text);
+    c.ends.push_back(c.text.size());
+    return c;
+}
+
+// An array of whatever ITEM writes, separated by commas.
+template <typename F>
+static bench::Corpus array_of(size_t size, F item)
+{
+    std::string s {};
+    s.reserve(size + size / 8);
+    s += '[';
+    for (bool first = true; s.size() < size; first = false) {
+        if (!first) s += ',';
+        item(s);
+    }
+    s += ']';
+    return make_corpus(std::move(s));
+}
+
+/* Times how long parsing CORPUS takes, per UNITS. Freeing the documents is
+ * left out.
+ */
+static bench::Measurement parse_stage(const char* name, const char* unit,
+                                      const bench::Corpus& corpus,
+                                      size_t units, const bench::Options& opts)
+{
+    io::NullLogger         logger {};
+    std::vector<sjp::Json> docs {};
+
+    double t = best_of(opts.reps,
+                       [&]() { docs = bench::parse(corpus, logger); },
+                       [&]() { docs.clear(); });
+    return { name, t * 1e9 / static_cast<double>(units), unit };
+}
+
+static bench::Measurement ws(const bench::Options& opts)
+{
+    static const char blanks[] = " \t\n\r      \n    ";
+    bench::Rng  rng { opts.seed };
+    std::string s { "[" };
+
+    s.reserve(opts.size + 1);
+    while (s.size() < opts.size) s += blanks[rng.below(sizeof(blanks) - 1)];
+    s += ']';
+    return parse_stage("ws", "ns/byte", make_corpus(std::move(s)),
+                       opts.size, opts);
+}
+
+static bench::Measurement string(const bench::Options& opts)
+{
+    bench::Rng rng { opts.seed };
+    size_t     bytes = 0;
+
+    auto corpus = array_of(opts.size, [&rng, &bytes](std::string& s) {
+        size_t n = 8 + rng.below(248);
+        s += '"';
+        for (size_t i = 0; i < n; i++)
+            s += static_cast<char>(rng.chance(15) ? ' ' : 'a' + rng.below(26));
+        s += '"';
+        bytes += n;
+    });
+    return parse_stage("string", "ns/byte", corpus, bytes, opts);
+}
+
+// Integers, decimals and exponents, which all take different paths.
+static bench::Measurement number(const bench::Options& opts)
+{
+    bench::Rng rng { opts.seed };
+    size_t     count = 0;
+
+    auto corpus = array_of(opts.size, [&rng, &count](std::string& s) {
+        char buf[32];
+        switch (rng.below(3)) {
+        case 0:
+            snprintf(buf, sizeof(buf), "%ld",
+                     static_cast<long>(rng.next() >> rng.below(64)));
+            break;
+        case 1:
+            snprintf(buf, sizeof(buf), "%.6f", rng.uniform(-1000, 1000));
+            break;
+        default:
+            snprintf(buf, sizeof(buf), "%.15g", rng.uniform(-1e300, 1e300));
+        }
+        s += buf;
+        count++;
+    });
+    return parse_stage("number", "ns/value", corpus, count, opts);
+}
+
+static bench::Measurement literal(const bench::Options& opts)
+{
+    static const char* literals[] = { "true", "false", "null" };
+    bench::Rng rng { opts.seed };
+    size_t     count = 0;
+
+    auto corpus = array_of(opts.size, [&rng, &count](std::string& s) {
+        s += literals[rng.below(3)];
+        count++;
+    });
+    return parse_stage("literal", "ns/value", corpus, count, opts);
+}
+
+/* A single object with lots of distinct keys, which mostly times inserting
+ * them. The values are all null, which is as cheap as it gets.
+ */
+static bench::Corpus wide_object(size_t size, std::vector<std::string>& keys)
+{
+    std::string s { "{" };
+    s.reserve(size + size / 8);
+    while (s.size() < size) {
+        keys.push_back("key_" + std::to_string(keys.size()));
+        if (keys.size() > 1) s += ',';
+        s += '"';
+        s += keys.back();
+        s += "\":null";
+    }
+    s += '}';
+    return make_corpus(std::move(s));
+}
+
+static bench::Measurement object(const bench::Options& opts)
+{
+    std::vector<std::string> keys {};
+    auto corpus = wide_object(opts.size, keys);
+    return parse_stage("object", "ns/key", corpus, keys.size(), opts);
+}
+
+// Every key of a wide object, in random order.
+static bench::Measurement lookup(const bench::Options& opts)
+{
+    io::NullLogger           logger {};
+    std::vector<std::string> keys {};
+    bench::Rng               rng { opts.seed };
+
+    auto corpus = wide_object(opts.size, keys);
+    auto docs   = bench::parse(corpus, logger);
+    for (size_t i = keys.size(); i > 1; i--)
+        std::swap(keys[i-1], keys[rng.below(i)]);
+
+    size_t found = 0;
+    double t = best_of(opts.reps, [&]() {
+        for (const auto& k : keys)
+            found += docs[0][k].get_type() == sjp::Type::Null;
+    }, []() {});
+
+    if (found != opts.reps * keys.size()) {
+        fprintf(stderr, "lookup: only found %zu of %zu keys\n", found,
+                opts.reps * keys.size());
+        exit(1);
+    }
+    return { "lookup", t * 1e9 / static_cast<double>(keys.size()), "ns/op" };
+}
+
+// Pretty-printing a realistic document, thrown away right into /dev/null.
+static bench::Measurement print(const bench::Options& opts)
+{
+    io::NullLogger  logger {};
+    bench::Corpus   corpus {};
+    sjp::ParseStats stats {};
+    size_t          nodes = 0;
+
+    bench::workloads[0].generate(corpus, opts.size, opts.seed);
+    auto docs = bench::parse(corpus, logger, &stats, &nodes);
+
+    FILE* null = fopen("/dev/null", "w");
+    if (!null) {
+        perror("/dev/null");
+        exit(1);
+    }
+    double t = best_of(opts.reps, [&]() { docs[0].print(null); }, []() {});
+    fclose(null);
+
+    return { "print", t * 1e9 / static_cast<double>(nodes), "ns/node" };
+}
+
+// ~JSON on the same kind of document, which needs a fresh parse every time.
+static bench::Measurement destroy(const bench::Options& opts)
+{
+    io::NullLogger         logger {};
+    bench::Corpus          corpus {};
+    sjp::ParseStats        stats {};
+    size_t                 nodes = 0;
+    std::vector<sjp::Json> docs {};
+
+    bench::workloads[0].generate(corpus, opts.size, opts.seed);
+    docs = bench::parse(corpus, logger, &stats, &nodes);
+
+    double t = best_of(opts.reps, [&]() { docs.clear(); },
+                       [&]() { docs = bench::parse(corpus, logger); });
+    return { "destroy", t * 1e9 / static_cast<double>(nodes), "ns/node" };
+}
+
+std::vector<bench::Measurement> bench::micro(const Options& opts)
+{
+    using Stage = Measurement (*)(const Options&);
+    static const Stage stages[] = {
+        ws, string, number, literal, object, lookup, print, destroy,
+    };
+
+    printf("inputs of ~%zu MiB, best of %zu runs, seed %lu\n",
+           opts.size >> 20, opts.reps, opts.seed);
+    printf("%-8s %10s\n", "stage", "time");
+
+    std::vector<Measurement> results {};
+    for (Stage stage : stages) {
+        results.push_back(stage(opts));
+        const Measurement& m = results.back();
+        printf("%-8s %10.2f %s\n", m.name.c_str(), m.value, m.unit.c_str());
+        fflush(stdout);
+    }
+    return results;
+}
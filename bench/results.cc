@@ -0,0 +1,102 @@
+/* Writing results files and comparing against them, see ``bench.hh''.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "bench.hh"
+
+bool bench::write_results(const char* path,
+                          const std::vector<Measurement>& results)
+{
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    fprintf(f, "# name\tvalue\tunit\n");
+    for (const auto& m : results)
+        fprintf(f, "%s\t%.6g\t%s\n", m.name.c_str(), m.value, m.unit.c_str());
+
+    if (fclose(f) != 0) {
+        perror(path);
+        return false;
+    }
+    return true;
+}
+
+static bool read_results(const char* path,
+                         std::vector<bench::Measurement>& results)
+{
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    char line[512];
+    for (size_t lineno = 1; fgets(line, sizeof(line), f); lineno++) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+
+        char   name[256], unit[64];
+        double value;
+        if (sscanf(line, "%255[^\t]\t%lf\t%63s", name, &value, unit) != 3) {
+            fprintf(stderr, "%s:%zu: malformed line\n", path, lineno);
+            fclose(f);
+            return false;
+        }
+        results.push_back({ name, value, unit });
+    }
+
+    fclose(f);
+    return true;
+}
+
+/* Measurements without a counterpart in the baseline (same name and unit)
+ * are listed as new, they can't be a regression.
+ */
+bool bench::compare(const char* path, const std::vector<Measurement>& results,
+                    double threshold)
+{
+    std::vector<Measurement> baseline {};
+    if (!read_results(path, baseline)) return false;
+
+    printf("\ncompared to `%s', more than %.1f%% slower is a regression\n",
+           path, threshold);
+    printf("%-20s %10s %10s %8s\n", "name", "baseline", "current", "change");
+
+    size_t regressions = 0;
+    for (const auto& m : results) {
+        const Measurement* old = nullptr;
+        for (const auto& b : baseline)
+            if (b.name == m.name && b.unit == m.unit) old = &b;
+
+        if (!old || old->value <= 0) {
+            printf("%-20s %10s %10.2f %8s\n", m.name.c_str(), "-", m.value,
+                   "new");
+            continue;
+        }
+
+        double change = (m.value / old->value - 1) * 100;
+        bool   slower = change > threshold;
+        printf("%-20s %10.2f %10.2f %+7.1f%%%s\n", m.name.c_str(), old->value,
+               m.value, change, slower ? "  REGRESSION" : "");
+        regressions += slower;
+    }
+
+    if (regressions)
+        printf("%zu regression(s) over %.1f%%\n", regressions, threshold);
+    return regressions == 0;
+}
@@ -0,0 +1,130 @@
+/* Implementation of SJP::OUTBUFFER, see ``buffer.hh''.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <unistd.h>
+
+#include "buffer.hh"
+#include "scan.hh"
+
+// A newline followed by MAX_INDENT levels of indentation (2 spaces each).
+static const std::string indentation = "\n" + std::string(2*64, ' ');
+
+void sjp::OutBuffer::init(void)
+{
+    static_assert(MAX_INDENT == 64, "adjust `indentation' as well");
+    buf.reserve(BLOCK_SIZE + BLOCK_SIZE/4);
+}
+
+void sjp::OutBuffer::newline(size_t d)
+{
+    if (d <= MAX_INDENT) {
+        put(std::string_view { indentation.data(), 1 + 2*d });
+        return;
+    }
+    put(std::string_view { indentation });
+    for (d -= MAX_INDENT; d > MAX_INDENT; d -= MAX_INDENT)
+        put(std::string_view { indentation.data()+1, 2*MAX_INDENT });
+    put(std::string_view { indentation.data()+1, 2*d });
+}
+
+/* Numbers are written in their shortest form that still parses back to the
+ * exact same double. Integral values (the common case) take a faster integer
+ * path. JSON cannot represent infinities, so they become `null'.
+ */
+void sjp::OutBuffer::put_number(double d)
+{
+    char tmp[32];
+    char* end;
+
+    if (!std::isfinite(d)) { put("null"); return; }
+
+    bool integral = d == std::trunc(d) && std::fabs(d) < 0x1p53;
+    if (integral && !(d == 0 && std::signbit(d))) // keep `-0' intact
+        end = std::to_chars(tmp, tmp+sizeof(tmp), static_cast<int64_t>(d)).ptr;
+    else
+        end = std::to_chars(tmp, tmp+sizeof(tmp), d).ptr;
+
+    put(tmp, static_cast<size_t>(end-tmp));
+}
+
+/* Runs of characters that don't need escaping are copied in one go. That's
+ * (almost) always the whole string.
+ */
+void sjp::OutBuffer::put_string(std::string_view s)
+{
+    static const char* hex = "0123456789abcdef";
+
+    put('"');
+    size_t i = 0;
+    while (i < s.size()) {
+        size_t j = i + find_special(s.data()+i, s.size()-i,
+                                    SCAN_QUOTE | SCAN_BACKSLASH | SCAN_CONTROL);
+        if (j > i) put(s.substr(i, j-i));
+        if (j == s.size()) break;
+
+        unsigned char c = static_cast<unsigned char>(s[j]);
+        switch (c) {
+        case '"':  put("\\\""); break;
+        case '\\': put("\\\\"); break;
+        case '\b': put("\\b"); break;
+        case '\f': put("\\f"); break;
+        case '\n': put("\\n"); break;
+        case '\r': put("\\r"); break;
+        case '\t': put("\\t"); break;
+        default: {
+            const char u[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+            put(u, sizeof(u));
+        }
+        }
+        i = j+1;
+    }
+    put('"');
+}
+
+void sjp::OutBuffer::flush(void)
+{
+    if (buf.empty()) return;
+
+    switch (sink) {
+    case Sink::Stream:
+        if (!stream || fwrite(buf.data(), 1, buf.size(), stream) != buf.size())
+            failed = true;
+        break;
+    case Sink::Fd: {
+        const char* p = buf.data();
+        size_t left = buf.size();
+        while (left > 0) {
+            ssize_t n = write(fd, p, left);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) { failed = true; break; }
+            p += n;
+            left -= static_cast<size_t>(n);
+        }
+        break;
+    }
+    case Sink::String:
+        // The first flush can simply steal our buffer.
+        if (str->empty()) { str->swap(buf); buf.reserve(BLOCK_SIZE); }
+        else              str->append(buf);
+        break;
+    }
+
+    buf.clear();
+}
@@ -0,0 +1,81 @@
+/* SJP::OUTBUFFER collects serialized JSON in memory and hands it to a sink
+ * (a FILE*, a file descriptor or a STD::STRING) in large blocks. Everything
+ * that produces JSON text writes into one of these.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef _BUFFER_HH_
+#define _BUFFER_HH_
+
+#include <string>
+#include <string_view>
+
+#include "common.hh"
+
+namespace sjp {
+    class OutBuffer;
+
+    // Pretty output puts every value on its own line and indents by 2.
+    enum class Style { Pretty, Compact };
+}
+
+class sjp::OutBuffer {
+    static constexpr size_t BLOCK_SIZE  = 1 << 16;
+    static constexpr size_t MAX_INDENT  = 64; // cached levels, more is fine
+
+    enum class Sink { Stream, Fd, String };
+
+    Sink         sink;
+    FILE*        stream = nullptr; // we don't own these
+    int          fd     = -1;
+    std::string* str    = nullptr;
+    std::string  buf    = {};
+    bool         failed = false;
+
+    void flush_block(void) { if (buf.size() >= BLOCK_SIZE) flush(); }
+
+public:
+    OutBuffer(FILE* s)        : sink { Sink::Stream }, stream { s } { init(); }
+    OutBuffer(int f)          : sink { Sink::Fd }, fd { f }         { init(); }
+    OutBuffer(std::string& s) : sink { Sink::String }, str { &s }   { init(); }
+    ~OutBuffer(void) { flush(); }
+
+    OutBuffer(const OutBuffer&) = delete;
+    OutBuffer(OutBuffer&&)      = delete;
+    OutBuffer& operator=(const OutBuffer&) = delete;
+    OutBuffer& operator=(OutBuffer&&)      = delete;
+
+    void put(char c)               { buf.push_back(c); flush_block(); }
+    void put(std::string_view s)   { buf.append(s); flush_block(); }
+    void put(const char* s, size_t n) { put(std::string_view { s, n }); }
+    void put_number(double);
+
+    // A JSON string literal, i.e. S in quotes and with escapes where needed.
+    void put_string(std::string_view s);
+
+    /* A line break followed by the indentation for depth D. Both come from a
+     * single cached string, so this is one append for all common depths.
+     */
+    void newline(size_t d);
+
+    void init(void);
+    void flush(void);
+
+    // False if the sink ever refused to take our data.
+    bool ok(void) const { return !failed; }
+};
+
+#endif /* _BUFFER_HH_ */
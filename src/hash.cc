@@ -0,0 +1,42 @@
+/* Where the seed for hashing object keys comes from, see ``hash.hh''.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <chrono>
+
+#include <unistd.h>
+
+#include "hash.hh"
+
+/* If the OS doesn't give us any entropy, the time, our PID and the address
+ * of a local variable (which ASLR moves around) are better than nothing.
+ * Mixing them makes every bit of the seed depend on all of them.
+ */
+sjp::HashSeed sjp::random_hash_seed(void)
+{
+    HashSeed seed {};
+    if (getentropy(&seed, sizeof seed) == 0) return seed;
+
+    uint64_t t = static_cast<uint64_t>(
+        std::chrono::steady_clock::now().time_since_epoch().count());
+    uint64_t a = reinterpret_cast<uintptr_t>(&seed);
+    uint64_t p = static_cast<uint64_t>(getpid());
+
+    seed.k0 = mix(t ^ 0x9e3779b97f4a7c15, a ^ 0xbf58476d1ce4e5b9);
+    seed.k1 = mix(seed.k0 ^ 0x94d049bb133111eb, p ^ t);
+    seed.k2 = mix(seed.k1 ^ 0x9e3779b97f4a7c15, a ^ p);
+    return seed;
+}
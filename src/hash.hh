@@ -0,0 +1,109 @@
+/* Keyed hashing for object keys. With a hash that anyone can compute, a
+ * producer can send us an object whose keys all land in the same bucket,
+ * which makes building it (and every lookup in it) quadratic. Our hash is
+ * keyed with secrets that are drawn at random once per process, so nobody
+ * outside of it knows which keys collide.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef _HASH_HH_
+#define _HASH_HH_
+
+#include <string_view>
+
+#include "common.hh"
+
+namespace sjp {
+    struct HashSeed {
+        uint64_t k0;
+        uint64_t k1;
+        uint64_t k2;
+    };
+
+    // Reads from the OS, see ``hash.cc''.
+    HashSeed random_hash_seed(void);
+
+    /* The seed that all object keys are hashed with. It's drawn when it's
+     * first needed and stays the same for the rest of the process, so
+     * hashes can be computed up front (see SJP::POINTER).
+     */
+    inline const HashSeed& hash_seed(void)
+    {
+        static const HashSeed seed { random_hash_seed() };
+        return seed;
+    }
+
+    // The 128 bit product of A and B, with its halves XORed together.
+    inline uint64_t mix(uint64_t a, uint64_t b)
+    {
+#ifdef __SIZEOF_INT128__
+        __uint128_t r = static_cast<__uint128_t>(a) * b;
+        return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+        uint64_t al = a & 0xffffffff, ah = a >> 32;
+        uint64_t bl = b & 0xffffffff, bh = b >> 32;
+        uint64_t ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+        uint64_t mid = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+        uint64_t lo  = (mid << 32) | (ll & 0xffffffff);
+        uint64_t hi  = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+        return lo ^ hi;
+#endif
+    }
+
+    inline uint64_t load64(const char* p)
+    {
+        uint64_t w;
+        memcpy(&w, p, sizeof w);
+        return w;
+    }
+
+    /* Keys of up to 16 bytes go into two words, so the ones we usually see
+     * take a single multiplication plus the final one. Longer ones are
+     * folded in 16 bytes at a time. Everything that's multiplied is XORed
+     * with a secret first, that's what keeps an attacker from forcing a
+     * product to zero. This is how Go hashes its map keys, too, when there
+     * are no AES instructions to use.
+     */
+    inline uint64_t hash_bytes(std::string_view s, const HashSeed& seed)
+    {
+        const char* p = s.data();
+        size_t      n = s.size();
+        uint64_t    a = 0, b = 0, state = seed.k0;
+
+        if (n > 16) {
+            for (; n > 16; n -= 16, p += 16)
+                state = mix(load64(p) ^ seed.k1, load64(p+8) ^ state);
+            a = load64(p+n-16);
+            b = load64(p+n-8);
+        } else {
+            /* Short keys have usually just been written, e.g. by the parser
+             * char by char. Wider loads across those stores would stall
+             * until they've reached the cache, bytes don't.
+             */
+            const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+            size_t i = 0;
+            for (; i < n && i < 8; i++) a |= uint64_t { u[i] } << (8 * i);
+            for (; i < n; i++)          b |= uint64_t { u[i] } << (8 * i - 64);
+        }
+
+        return mix(seed.k1 ^ s.size(), mix(a ^ seed.k1, b ^ state ^ seed.k2));
+    }
+
+    inline uint64_t hash_key(std::string_view s)
+    { return hash_bytes(s, hash_seed()); }
+}
+
+#endif /* _HASH_HH_ */
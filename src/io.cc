@@ -17,6 +17,7 @@
  * You should have received a copy of the GNU General Public License
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
+#include <algorithm>
 #include <ctime>
 #include <unistd.h>
 
@@ -24,126 +25,260 @@
 
 const char* TIME_FORMAT = "[%F %H:%M:%S]";
 
-static void pr_time(FILE* stream)
+/* Formatting the time is expensive compared to everything else we do, but
+ * the result only changes once per second. Thus, every thread remembers the
+ * last stamp it produced.
+ */
+static const char* time_stamp(time_t t)
 {
-    time_t t = time(nullptr);
-    struct tm* tm = localtime(&t);
+    thread_local time_t last = -1;
+    thread_local char   stamp[32] {};
+
+    if (t != last) {
+        struct tm tm {};
+        if (!localtime_r(&t, &tm) ||
+            strftime(stamp, sizeof(stamp), TIME_FORMAT, &tm) == 0) {
+            fprintf(stderr, "logger: internal error in `time_stamp()'\n");
+            exit(1);
+        }
+        last = t;
+    }
+    return stamp;
+}
+
+/* Everything that comes before the message. Gives how many chars went into
+ * LINE, which is never more than half of SIZE. The rest is for the message.
+ */
+static size_t put_prefix(char* line, size_t size, time_t t, io::Level l,
+                         const char* prog_name, bool colored)
+{
+    using ansi::AnsiColor;
+    static const char* labels[] = { "log", "warning", "error" };
+    static const AnsiColor colors[] = {
+        AnsiColor::FG_BLUE, AnsiColor::FG_YELLOW, AnsiColor::FG_RED
+    };
+
+    size_t i = static_cast<size_t>(l);
+    int n = snprintf(line, size, "%s%s %s: %s:%s ", time_stamp(t),
+                     colored ? ansi::color_to_str(colors[i]) : "", prog_name,
+                     labels[i],
+                     colored ? ansi::color_to_str(AnsiColor::RESET) : "");
+    if (n < 0) {
+        fprintf(stderr, "logger: internal error in `put_prefix()'\n");
+        exit(1);
+    }
+    return std::min(static_cast<size_t>(n), size/2);
+}
 
-    char buf[BUFSIZ] {};
-    if (!tm)                                              goto early_error;
-    if (strftime(buf, sizeof(buf), TIME_FORMAT, tm) == 0) goto early_error;
+/* Formats FMT into BUF (of SIZE bytes, at least 4), cutting it off with an
+ * ellipsis if it doesn't fit. Gives the length of the result.
+ */
+static size_t put_message(char* buf, size_t size, const char* fmt, va_list ap)
+{
+    int n = vsnprintf(buf, size, fmt, ap);
+    if (n < 0) {
+        fprintf(stderr, "logger: internal error in `put_message()'\n");
+        exit(1);
+    }
 
-    fprintf(stream, "%s", buf);
-    return;
+    if (static_cast<size_t>(n) < size) return n;
+    memcpy(buf+size-4, "...", 4);
+    return size-1;
+}
 
-early_error:
-    fprintf(stream, "logger: internal error in `pr_time()'\n");
-    exit(1);
+/* The whole line is formatted into a buffer on the stack and written with a
+ * single call, so we never allocate. Overly long messages are cut off.
+ */
+void io::SjpLogger::write(Level l, const char* fmt, va_list ap) const
+{
+    char line[1024];
+    size_t used = put_prefix(line, sizeof(line), time(nullptr), l, prog_name,
+                             colored);
+    used += put_message(line+used, sizeof(line)-1 - used, fmt, ap);
+    line[used++] = '\n';
+    fwrite(line, 1, used, out_stream);
 }
 
 void io::SjpLogger::log(const char* fmt, ...) const
 {
-    if (!out_stream) return;
+    if (!out_stream || !enabled(Level::Log)) return;
 
     va_list ap;
     va_start(ap, fmt);
-    char* msg {};
-    int n = vsnprintf(msg, 0, fmt, ap);
+    write(Level::Log, fmt, ap);
     va_end(ap);
-    if (n < 0) goto early_error;
+}
 
-    msg = (char*)malloc(n+1); // man 3 vsnprintf
-    if (!msg) goto early_error;
+void io::SjpLogger::warn(const char* fmt, ...) const
+{
+    if (!out_stream || !enabled(Level::Warn)) return;
 
+    va_list ap;
     va_start(ap, fmt);
-    n = vsnprintf(msg, n+1, fmt, ap);
+    write(Level::Warn, fmt, ap);
     va_end(ap);
-    if (n < 0) goto early_error;
-
-    pr_time(out_stream);
-    ansi::enable_color(ansi::AnsiColor::FG_BLUE, out_stream);
-    fprintf(out_stream, " %s: log:", prog_name);
-    ansi::reset_color(out_stream);
-    fprintf(out_stream, " %s\n", msg);
-
-    free(msg);
-    return;
+}
 
-early_error:
-    free(msg);
-    fprintf(out_stream, "logger: internal error in `error()'\n");
+[[noreturn]] void io::SjpLogger::error(const char* fmt, ...) const
+{
+    if (out_stream && enabled(Level::Error)) {
+        va_list ap;
+        va_start(ap, fmt);
+        write(Level::Error, fmt, ap);
+        va_end(ap);
+    }
     exit(1);
 }
 
-void io::SjpLogger::warn(const char* fmt, ...) const
+io::AsyncLogger::AsyncLogger(const char* name, FILE* os)
+    : prog_name { strip_dir(name) }, out_stream { os },
+      colored { os && isatty(fileno(os)) },
+      slots { std::make_unique<Slot[]>(SLOTS) }, worker {}
 {
-    if (!out_stream) return;
-
-    va_list ap;
-    va_start(ap, fmt);
-    char* msg = nullptr;
-    int n = vsnprintf(msg, 0, fmt, ap);
-    va_end(ap);
-    if (n < 0) goto early_error;
+    for (size_t i = 0; i < SLOTS; i++) slots[i].seq = i;
+    worker = std::thread { &AsyncLogger::run, this };
+}
 
-    msg = (char*)malloc(n+1); // man 3 vsnprintf
-    if (!msg) goto early_error;
+// Everything that was logged before is still written out.
+io::AsyncLogger::~AsyncLogger(void)
+{
+    while (push(Level::Off, nullptr, nullptr) == 0) std::this_thread::yield();
+    worker.join();
+}
 
-    va_start(ap, fmt);
-    n = vsnprintf(msg, n+1, fmt, ap);
-    va_end(ap);
-    if (n < 0) goto early_error;
+/* A slot whose SEQ equals the position we got from HEAD is free. We claim it
+ * by moving HEAD on, fill it and then publish it to the background thread by
+ * setting SEQ to the next position. Gives how many messages were pushed so
+ * far (including this one), or 0 if the ring is full.
+ */
+size_t io::AsyncLogger::push(Level l, const char* fmt, va_list* ap) const
+{
+    size_t pos = head.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &slots[pos & (SLOTS-1)];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        auto diff = static_cast<ptrdiff_t>(seq - pos);
+
+        if (diff == 0) {
+            if (head.compare_exchange_weak(pos, pos+1,
+                                           std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return 0; // the background thread is a whole lap behind
+        } else {
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
 
-    pr_time(out_stream);
-    ansi::enable_color(ansi::AnsiColor::FG_YELLOW, out_stream);
-    fprintf(out_stream, " %s: warning:", prog_name);
-    ansi::reset_color(out_stream);
-    fprintf(out_stream, " %s\n", msg);
+    slot->level = l;
+    slot->time  = time(nullptr);
+    if (fmt) put_message(slot->msg, MAX_MESSAGE, fmt, *ap);
+    slot->seq.store(pos+1, std::memory_order_release);
+    head.notify_one();
 
-    free(msg);
-    return;
+    return pos+1;
+}
 
-early_error:
-    free(msg);
-    fprintf(out_stream, "logger: internal error in `error()'\n");
-    exit(1);
+/* Lines are collected in a batch, which is written whenever the ring runs
+ * empty, it fills up or an error comes along. Only then do we tell ERROR that
+ * its message is out.
+ */
+void io::AsyncLogger::run(void)
+{
+    char batch[1 << 16];
+    size_t used = 0;
+
+    auto flush = [this, &batch, &used](size_t done) {
+        if (used > 0) {
+            fwrite(batch, 1, used, out_stream);
+            fflush(out_stream);
+            used = 0;
+        }
+        written.store(done, std::memory_order_release);
+        written.notify_all();
+    };
+
+    auto put_line = [this, &batch, &used](time_t t, Level l, const char* msg) {
+        used += put_prefix(batch+used, 2*MAX_MESSAGE, t, l, prog_name,
+                           colored);
+        size_t n = strlen(msg);
+        memcpy(batch+used, msg, n);
+        used += n;
+        batch[used++] = '\n';
+    };
+
+    for (size_t tail = 0;; tail++) {
+        Slot& slot = slots[tail & (SLOTS-1)];
+
+        if (slot.seq.load(std::memory_order_acquire) != tail+1) {
+            flush(tail);
+            while (slot.seq.load(std::memory_order_acquire) != tail+1) {
+                // Nobody has claimed the slot yet, so we can sleep.
+                size_t h = head.load(std::memory_order_acquire);
+                if (h == tail) head.wait(h, std::memory_order_acquire);
+                else           std::this_thread::yield();
+            }
+        }
+
+        // There might be two lines to put, each taking up to 2*MAX_MESSAGE.
+        if (used + 4*MAX_MESSAGE > sizeof(batch)) flush(tail);
+        if (size_t n = dropped.exchange(0, std::memory_order_relaxed)) {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "logger: dropped %ld messages", n);
+            put_line(slot.time, Level::Warn, msg);
+        }
+
+        if (slot.level == Level::Off) {
+            flush(tail);
+            return;
+        }
+        put_line(slot.time, slot.level, slot.msg);
+
+        Level level = slot.level;
+        slot.seq.store(tail + SLOTS, std::memory_order_release);
+        if (level == Level::Error) flush(tail+1);
+    }
 }
 
-[[noreturn]] void io::SjpLogger::error(const char* fmt, ...) const
+void io::AsyncLogger::log(const char* fmt, ...) const
 {
-    if (!out_stream) exit(1);
+    if (!out_stream || !enabled(Level::Log)) return;
 
     va_list ap;
     va_start(ap, fmt);
-
-    char* msg = nullptr;
-    int n = vsnprintf(msg, 0, fmt, ap);
+    if (push(Level::Log, fmt, &ap) == 0)
+        dropped.fetch_add(1, std::memory_order_relaxed);
     va_end(ap);
-    if (n < 0) goto early_error;
-    msg = (char*)malloc(n+1); // man 3 vsnprintf
-    if (!msg) goto early_error;
+}
 
+void io::AsyncLogger::warn(const char* fmt, ...) const
+{
+    if (!out_stream || !enabled(Level::Warn)) return;
+
+    va_list ap;
     va_start(ap, fmt);
-    n = vsnprintf(msg, n+1, fmt, ap);
+    if (push(Level::Warn, fmt, &ap) == 0)
+        dropped.fetch_add(1, std::memory_order_relaxed);
     va_end(ap);
-    if (n < 0) goto early_error;
-
-    pr_time(out_stream);
-    ansi::enable_color(ansi::AnsiColor::FG_RED, out_stream);
-    fprintf(out_stream, " %s: error:", prog_name);
-    ansi::reset_color(out_stream);
-    fprintf(out_stream, " %s\n", msg);
-
-    free(msg);
-    exit(1);
+}
 
-early_error:
-    free(msg);
-    fprintf(out_stream, "logger: internal error in `error()'\n");
+[[noreturn]] void io::AsyncLogger::error(const char* fmt, ...) const
+{
+    if (out_stream && enabled(Level::Error)) {
+        va_list ap;
+        va_start(ap, fmt);
+        size_t pushed;
+        while ((pushed = push(Level::Error, fmt, &ap)) == 0)
+            std::this_thread::yield();
+        va_end(ap);
+
+        for (size_t w; (w = written.load(std::memory_order_acquire)) < pushed;)
+            written.wait(w, std::memory_order_acquire);
+    }
     exit(1);
 }
 
-
 const char* ansi::color_to_str(AnsiColor color)
 {
     using _ = AnsiColor;
@@ -21,16 +21,32 @@
 #ifndef _IO_HH_
 #define _IO_HH_
 
+#include <atomic>
 #include <cstdarg>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <unistd.h>
 
 #include "common.hh"
 
 static const char* strip_dir(const char*);
 
+/* Logging calls below this level (0 = log, 1 = warn, 2 = error) are compiled
+ * out of the library, as long as they are guarded by LOGGER::ENABLED. Errors
+ * still end the process, they're just not printed.
+ */
+#ifndef IO_MIN_LEVEL
+#define IO_MIN_LEVEL 0
+#endif
+
 namespace io {
     class Logger;
     class SjpLogger;
+    class AsyncLogger;
     class NullLogger;
+
+    enum class Level { Log, Warn, Error, Off };
 }
 
 namespace ansi {
@@ -49,11 +65,21 @@ namespace ansi {
     void reset_color(FILE*);
 }
 
-// The abstract base class all concrete loggers must be based on.
+/* The abstract base class all concrete loggers must be based on. Callers that
+ * do any work to produce a message's arguments should check ENABLED first,
+ * which is free for levels below IO_MIN_LEVEL.
+ */
 class io::Logger {
+protected:
+    Level level = Level::Log;
+
 public:
     virtual ~Logger(void) {}
 
+    void set_level(Level l) { level = l; }
+    bool enabled(Level l) const
+    { return static_cast<int>(l) >= IO_MIN_LEVEL && l >= level; }
+
     virtual void log(const char*, ...) const = 0;
     virtual void warn(const char*, ...) const = 0;
     [[noreturn]] virtual void error(const char*, ...) const = 0;
@@ -62,10 +88,14 @@ public:
 class io::SjpLogger : public io::Logger {
     const char* prog_name;
     FILE* out_stream; // we don't own this stream, so we don't free it
+    bool  colored;    // checked once, the stream won't become a tty later
+
+    void write(Level, const char*, va_list) const;
 
 public:
     SjpLogger(const char* name, FILE* os)
-        : prog_name { strip_dir(name) }, out_stream { os } {}
+        : prog_name { strip_dir(name) }, out_stream { os },
+          colored { os && isatty(fileno(os)) } {}
     SjpLogger(void) : SjpLogger { "unknown", stderr } {}
     virtual ~SjpLogger(void) {}
 
@@ -80,12 +110,63 @@ public:
     [[noreturn]] virtual void error(const char*, ...) const override;
 };
 
+/* Produces the same output as IO::SJPLOGGER, but only formats the message on
+ * the calling thread. Writing it out happens on a background thread, which
+ * gets the messages through a bounded lock-free ring (after Dmitry Vyukov's
+ * MPMC queue). Thus, logging never blocks: if the ring is full, messages are
+ * dropped and counted. Only errors wait for a free slot, and ERROR doesn't
+ * end the process before everything up to the error has been written.
+ */
+class io::AsyncLogger : public io::Logger {
+public:
+    static constexpr size_t SLOTS       = 1024; // must be a power of 2
+    static constexpr size_t MAX_MESSAGE = 256;  // longer ones are cut off
+
+private:
+    // A slot with LEVEL set to OFF tells the background thread to stop.
+    struct Slot {
+        std::atomic<size_t> seq = 0;
+        Level  level            = Level::Log;
+        time_t time             = 0;
+        char   msg[MAX_MESSAGE] = {};
+    };
+
+    const char*             prog_name;
+    FILE*                   out_stream; // we don't own this stream
+    bool                    colored;
+    std::unique_ptr<Slot[]> slots;
+
+    // Producers and the background thread each get their own cache line.
+    alignas(64) mutable std::atomic<size_t> head    { 0 }; // next free slot
+    alignas(64) mutable std::atomic<size_t> written { 0 }; // messages written
+    mutable std::atomic<size_t>             dropped { 0 };
+
+    std::thread worker; // must come last, it starts running right away
+
+    size_t push(Level, const char*, va_list*) const;
+    void run(void);
+
+public:
+    AsyncLogger(const char*, FILE*);
+    AsyncLogger(void) : AsyncLogger { "unknown", stderr } {}
+    virtual ~AsyncLogger(void);
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger(AsyncLogger&&)      = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(AsyncLogger&&)      = delete;
+
+    virtual void log(const char*, ...) const override;
+    virtual void warn(const char*, ...) const override;
+    [[noreturn]] virtual void error(const char*, ...) const override;
+};
+
 /* A minimal interface implementation that can be passed if no logging should
  * be done.
  */
 class io::NullLogger : public io::Logger {
 public:
-    NullLogger(void) {}
+    NullLogger(void) { level = Level::Off; }
     virtual ~NullLogger(void) {}
 
     virtual void log(const char*, ...) const override {}
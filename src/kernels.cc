@@ -0,0 +1,231 @@
+/* Implementations of the aggregate kernels declared in ``kernels.hh''. Every
+ * kernel has a fast path over a numeric array's contiguous storage and a
+ * scalar path for everything else.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "kernels.hh"
+
+using span = std::span<const double>;
+
+/* The scalar path visits every number in a mixed array. Non-arrays have a
+ * size of 1 but OPERATOR[] gives us JSONNONE for them, so they're skipped
+ * without special-casing.
+ */
+template<typename F>
+static void for_each_number(const sjp::JsonValue& arr, F f)
+{
+    if (arr.get_type() != sjp::Type::Array) return;
+    for (size_t i = 0; i < arr.size(); i++)
+        if (std::optional<double> d = arr[i].get_number(); d) f(*d);
+}
+
+// The value at position I of ARR, reading from NUMS if ARR is numeric.
+static std::optional<double> number_at(const sjp::JsonValue& arr,
+                                       const std::optional<span>& nums,
+                                       size_t i)
+{
+    if (nums) return (*nums)[i];
+    return arr[i].get_number();
+}
+
+static double sum_numbers(span s)
+{
+    size_t i = 0;
+    double acc = 0.0;
+
+#ifdef __SSE2__
+    // Two independent accumulators to hide the latency of the adds.
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    for (; i+4 <= s.size(); i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_loadu_pd(s.data()+i));
+        acc1 = _mm_add_pd(acc1, _mm_loadu_pd(s.data()+i+2));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    acc = lanes[0] + lanes[1];
+#endif
+
+    for (; i < s.size(); i++) acc += s[i];
+    return acc;
+}
+
+static double min_numbers(span s)
+{
+    size_t i = 0;
+    double m = s[0];
+
+#ifdef __SSE2__
+    if (s.size() >= 2) {
+        __m128d acc = _mm_loadu_pd(s.data());
+        for (i = 2; i+2 <= s.size(); i += 2)
+            acc = _mm_min_pd(acc, _mm_loadu_pd(s.data()+i));
+        double lanes[2];
+        _mm_storeu_pd(lanes, acc);
+        m = std::min(lanes[0], lanes[1]);
+    }
+#endif
+
+    for (; i < s.size(); i++) m = std::min(m, s[i]);
+    return m;
+}
+
+static double max_numbers(span s)
+{
+    size_t i = 0;
+    double m = s[0];
+
+#ifdef __SSE2__
+    if (s.size() >= 2) {
+        __m128d acc = _mm_loadu_pd(s.data());
+        for (i = 2; i+2 <= s.size(); i += 2)
+            acc = _mm_max_pd(acc, _mm_loadu_pd(s.data()+i));
+        double lanes[2];
+        _mm_storeu_pd(lanes, acc);
+        m = std::max(lanes[0], lanes[1]);
+    }
+#endif
+
+    for (; i < s.size(); i++) m = std::max(m, s[i]);
+    return m;
+}
+
+static double dot_numbers(span a, span b)
+{
+    size_t i = 0;
+    double acc = 0.0;
+
+#ifdef __SSE2__
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    for (; i+4 <= a.size(); i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a.data()+i),
+                                           _mm_loadu_pd(b.data()+i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a.data()+i+2),
+                                           _mm_loadu_pd(b.data()+i+2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    acc = lanes[0] + lanes[1];
+#endif
+
+    for (; i < a.size(); i++) acc += a[i] * b[i];
+    return acc;
+}
+
+size_t sjp::count(const JsonValue& arr)
+{
+    if (std::optional<span> nums = arr.get_numbers(); nums)
+        return nums->size();
+
+    size_t n = 0;
+    for_each_number(arr, [&n](double) { n++; });
+    return n;
+}
+
+double sjp::sum(const JsonValue& arr)
+{
+    if (std::optional<span> nums = arr.get_numbers(); nums)
+        return sum_numbers(*nums);
+
+    double s = 0.0;
+    for_each_number(arr, [&s](double d) { s += d; });
+    return s;
+}
+
+std::optional<double> sjp::min(const JsonValue& arr)
+{
+    if (std::optional<span> nums = arr.get_numbers(); nums) {
+        if (nums->empty()) return std::nullopt;
+        return min_numbers(*nums);
+    }
+
+    std::optional<double> m = std::nullopt;
+    for_each_number(arr, [&m](double d) { m = m ? std::min(*m, d) : d; });
+    return m;
+}
+
+std::optional<double> sjp::max(const JsonValue& arr)
+{
+    if (std::optional<span> nums = arr.get_numbers(); nums) {
+        if (nums->empty()) return std::nullopt;
+        return max_numbers(*nums);
+    }
+
+    std::optional<double> m = std::nullopt;
+    for_each_number(arr, [&m](double d) { m = m ? std::max(*m, d) : d; });
+    return m;
+}
+
+std::optional<double> sjp::mean(const JsonValue& arr)
+{
+    if (std::optional<span> nums = arr.get_numbers(); nums) {
+        if (nums->empty()) return std::nullopt;
+        return sum_numbers(*nums) / static_cast<double>(nums->size());
+    }
+
+    double s = 0.0;
+    size_t n = 0;
+    for_each_number(arr, [&s, &n](double d) { s += d; n++; });
+    if (n == 0) return std::nullopt;
+    return s / static_cast<double>(n);
+}
+
+std::vector<size_t> sjp::histogram(const JsonValue& arr, double lo,
+                                   double hi, size_t bins)
+{
+    if (bins == 0 || !(lo < hi)) return {};
+
+    std::vector<size_t> hist(bins, 0);
+    const double scale = static_cast<double>(bins) / (hi - lo);
+    auto add = [&](double d) {
+        if (!(d >= lo && d <= hi)) return;
+        size_t b = static_cast<size_t>((d - lo) * scale);
+        hist[std::min(b, bins-1)]++;
+    };
+
+    if (std::optional<span> nums = arr.get_numbers(); nums)
+        for (double d: *nums) add(d);
+    else
+        for_each_number(arr, add);
+
+    return hist;
+}
+
+std::optional<double> sjp::dot(const JsonValue& a, const JsonValue& b)
+{
+    if (a.get_type() != Type::Array || b.get_type() != Type::Array)
+        return std::nullopt;
+    if (a.size() != b.size()) return std::nullopt;
+
+    std::optional<span> nums_a = a.get_numbers();
+    std::optional<span> nums_b = b.get_numbers();
+    if (nums_a && nums_b) return dot_numbers(*nums_a, *nums_b);
+
+    double acc = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+        std::optional<double> x = number_at(a, nums_a, i);
+        std::optional<double> y = number_at(b, nums_b, i);
+        if (x && y) acc += *x * *y;
+    }
+    return acc;
+}
@@ -0,0 +1,52 @@
+/* Aggregate kernels over JSONARRAYs. Numeric arrays (see ``sjp.hh'') are
+ * reduced straight from their contiguous storage, using SSE2 where it's
+ * available. Mixed arrays fall back to a scalar loop that ignores every
+ * element which isn't a number.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef _KERNELS_HH_
+#define _KERNELS_HH_
+
+#include <optional>
+#include <vector>
+
+#include "common.hh"
+#include "sjp.hh"
+
+/* All kernels take a JSONVALUE& since that's what OPERATOR[] hands out. If
+ * the value isn't an array, it's treated like an array without numbers.
+ */
+namespace sjp {
+    size_t                count(const JsonValue&);
+    double                sum(const JsonValue&);
+    std::optional<double> min(const JsonValue&);
+    std::optional<double> max(const JsonValue&);
+    std::optional<double> mean(const JsonValue&);
+
+    /* BINS equally sized buckets over [LO, HI]. Numbers outside of that
+     * range aren't counted, HI itself goes into the last bucket.
+     */
+    std::vector<size_t> histogram(const JsonValue&, double lo,
+                                  double hi, size_t bins);
+
+    /* Both arrays must have the same size. For mixed arrays, only positions
+     * that hold a number in both arrays contribute to the result.
+     */
+    std::optional<double> dot(const JsonValue&, const JsonValue&);
+}
+
+#endif /* _KERNELS_HH_ */
@@ -17,9 +17,19 @@
  * You should have received a copy of the GNU General Public License
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <thread>
+
 #include "common.hh"
 #include "io.hh"
+#include "kernels.hh"
+#include "pointer.hh"
 #include "sjp.hh"
+#include "validate.hh"
+#include "writer.hh"
 
 const char* infile = "data/test.json";
 
@@ -34,18 +44,27 @@ int main(int /*argc*/, char** argv)
     sjp::Parser parser0 { stream, &logger };
     auto parser { std::move(parser0) }; // move-constructable
 
+    sjp::ParseStats stats {};
+    parser.set_stats(&stats); // optional, see SJP_STATS
+
     sjp::Json json { parser.parse() };
     json.print(stderr); // pretty-prints the parsed JSON to a FILE*
+    logger.log("parsed %ld bytes into %ld objects and %ld arrays in %ldus",
+               stats.bytes, stats.count(sjp::Type::Object),
+               stats.count(sjp::Type::Array), stats.total_ns / 1000);
+    logger.log("the document takes %ld bytes of memory (%.1fx its size)",
+               json.memory_usage(),
+               static_cast<double>(json.memory_usage()) / stats.bytes);
 
     /* Now, we can read data from the SJP::JSON object.
      * JSONOBJECTs are accessed via OPERATOR[] and string keys.
      */
-    sjp::JsonValue& array { json["data"]["deeply"]["nested"] };
+    const sjp::JsonValue& array { json["data"]["deeply"]["nested"] };
     assert(array.get_type() == sjp::Type::Array);
 
     std::vector<double> v {};
     for (size_t i = 0; i < array.size(); i++) {
-        sjp::JsonValue& item { array[i] };
+        const sjp::JsonValue& item { array[i] };
 
         /* JSONARRAYs can be accessed via OPERATOR[] and integer keys.
          * We get a JSONVALUE&, which we must cast to the actual type before
@@ -56,7 +75,9 @@ int main(int /*argc*/, char** argv)
          */
 #if 0
          if (item.get_type() == sjp::Type::Number) {
-             sjp::JsonNumber& n { static_cast<sjp::JsonNumber&>(item) };
+             const sjp::JsonNumber& n {
+                 static_cast<const sjp::JsonNumber&>(item)
+             };
              v.push_back(n.value);
          } else {
              logger.warn("ignoring non-number item of type `%s'",
@@ -78,9 +99,298 @@ int main(int /*argc*/, char** argv)
 #endif
     }
 
-    double s = 0.0;
-    std::for_each(v.begin(), v.end(), [&s](const double&d) { s += d; });
-    logger.log("sum over all number items in the array: %g", s);
+    /* For aggregations, we don't have to write such a loop ourselves. The
+     * kernels in ``kernels.hh'' skip non-number items and reduce arrays that
+     * only hold numbers straight from their contiguous storage.
+     */
+    assert(sjp::count(array) == v.size());
+    logger.log("sum over all number items in the array: %g", sjp::sum(array));
+    logger.log("mean: %g, min: %g, max: %g", *sjp::mean(array),
+               *sjp::min(array), *sjp::max(array));
+
+    /* Paths that are evaluated over and over again can be compiled into an
+     * SJP::POINTER (RFC 6901) once. Resolving it then doesn't allocate, and
+     * RESOLVE_NUMBER reads items of numeric arrays without creating any
+     * JSONNUMBERs for them.
+     */
+    std::optional<sjp::Pointer> ptr {
+        sjp::Pointer::compile("/data/deeply/nested/1")
+    };
+    assert(ptr && ptr->resolve_number(json) == 4230.0);
+
+    /* If we know up front which paths we need, the parser can skip over
+     * everything else instead of building it.
+     */
+    rewind(stream);
+    sjp::Parser projecting_parser { stream, &logger };
+    sjp::Json projected { projecting_parser.parse(std::span { &*ptr, 1 }) };
+    assert(ptr->resolve_number(projected) == 4230.0);
+    assert(projected["format"].get_type() == sjp::Type::None);
+
+    /* If we want all items of an array as a certain type, we can extract
+     * them in bulk. Here, the single non-integer item is skipped.
+     */
+    std::optional<std::vector<int64_t>> modes {
+        json["format"]["modes"].to_vector<int64_t>(sjp::Mismatch::Skip)
+    };
+    assert(modes && modes->size() == 5);
+    logger.log("extracted %ld integer modes", modes->size());
+
+    /* We can also produce JSON without a JSON object. SJP::WRITER emits
+     * values straight into an output buffer and validates the nesting.
+     */
+    {
+        sjp::OutBuffer out { stderr };
+        sjp::Writer writer { out };
+        writer.begin_object();
+        writer.key("modes");
+        writer.begin_array();
+        for (int64_t m: *modes) writer.value(m);
+        writer.end_array();
+        writer.key("sum");
+        writer.value(sjp::sum(array));
+        writer.end_object();
+        assert(writer.complete());
+        out.put('\n');
+    }
+
+    /* Strings are escaped on the way out, so whatever they hold, printing
+     * them gives valid JSON. Long plain runs are copied 16 bytes at a time,
+     * the bytes that need escaping and the short tail one by one.
+     */
+    {
+        std::string text { "[\"" };
+        for (char c = 1; c < 0x20; c++)
+            if (c != '\n') text += std::string(40, 'x') + c;
+        text += "\\\" \\\\ \\n " + std::string(100, 'y') + "\\t end\"]";
+
+        FILE* text_stream = fmemopen(text.data(), text.size(), "r");
+        sjp::Parser text_parser { text_stream, &logger };
+        sjp::Json escaped { text_parser.parse() };
+        fclose(text_stream);
+        assert(sjp::validate(escaped.to_string()));
+        assert(sjp::validate(escaped.to_string(sjp::Style::Pretty)));
+    }
+
+    /* Numbers are printed in their shortest form that reads back as the
+     * exact same double, so printing and parsing them again loses nothing.
+     */
+    {
+        std::mt19937_64     rng { 42 };
+        std::vector<double> doubles {};
+        while (doubles.size() < 10000) {
+            double d = std::bit_cast<double>(rng());
+            if (std::isfinite(d)) doubles.push_back(d);
+        }
+
+        std::string text {};
+        {
+            sjp::OutBuffer out { text };
+            sjp::Writer writer { out };
+            writer.begin_array();
+            for (double d: doubles) writer.value(d);
+            writer.end_array();
+        }
+
+        FILE* numbers_stream = fmemopen(text.data(), text.size(), "r");
+        sjp::Parser numbers_parser { numbers_stream, &logger };
+        sjp::Json numbers { numbers_parser.parse() };
+        std::optional<std::span<const double>> parsed {
+            numbers.get_root().get_numbers()
+        };
+        assert(parsed && parsed->size() == doubles.size() &&
+               !memcmp(parsed->data(), doubles.data(),
+                       doubles.size() * sizeof(double)));
+        logger.log("%ld random doubles survived printing and parsing",
+                   doubles.size());
+        fclose(numbers_stream);
+    }
+
+    /* If we only need to know whether some input is well-formed JSON, we
+     * don't have to build anything at all.
+     */
+    sjp::Validation valid { sjp::validate("{\"a\": [1, 2, tru]}") };
+    assert(!valid && valid.offset == 13);
+    logger.log("invalid input: %s at offset %ld", valid.error, valid.offset);
+
+    /* Errors in the input don't have to end the process. TRY_PARSE hands
+     * them back instead, and the parser can go on with the next input.
+     */
+    char broken[] = "{\"a\": [1, 2,]}";
+    FILE* broken_stream = fmemopen(broken, sizeof broken - 1, "r");
+    parser.reset(broken_stream);
+    sjp::ParseResult result { parser.try_parse() };
+    assert(!result &&
+           result.error.code == sjp::ParseError::Code::UnexpectedChar);
+    assert(result.error.offset == sjp::validate(broken).offset);
+    logger.log("recovered from error: %s", result.error.message.c_str());
+    fclose(broken_stream);
+
+    /* Warnings don't stop a parse. Per document, the parser logs a single
+     * line per kind with how often it came up and where it did first.
+     */
+    {
+        char*  warn_text = nullptr;
+        size_t warn_size = 0;
+        FILE*  warn_stream = open_memstream(&warn_text, &warn_size);
+        io::SjpLogger warn_logger { *argv, warn_stream };
+
+        char dups[] = "{\"a\": 1, \"b\": 2, \"a\": 3, \"a\": 4}";
+        FILE* dups_stream = fmemopen(dups, sizeof dups - 1, "r");
+        sjp::Parser dups_parser { dups_stream, &warn_logger };
+        sjp::Json first_wins { dups_parser.parse() };
+        fclose(dups_stream);
+        fclose(warn_stream);
+
+        assert(first_wins["a"].get_number() == 1.0);
+        assert(!warn_logger.enabled(io::Level::Warn) ||
+               strstr(warn_text, "ignoring 2 duplicate keys, first `a' "
+                                 "at 1:18 (offset 17)"));
+        logger.log("duplicate keys were reported once");
+        free(warn_text);
+    }
+
+    /* MEMORY_USAGE counts every node, so a document that has all the members
+     * of another one plus some more takes more memory.
+     */
+    {
+        auto parse = [&logger](std::string text) -> sjp::Json {
+            FILE* text_stream = fmemopen(text.data(), text.size(), "r");
+            sjp::Parser text_parser { text_stream, &logger };
+            sjp::Json result { text_parser.parse() };
+            fclose(text_stream);
+            return result;
+        };
+
+        sjp::Json small { parse("{\"a\": [1, \"x\"]}") };
+        sjp::Json large {
+            parse("{\"a\": [1, \"x\", null], \"b\": {\"c\": 2}}")
+        };
+        assert(small.memory_usage() < large.memory_usage());
+        logger.log("%ld bytes for 4 nodes, %ld bytes for 7 nodes",
+                   small.memory_usage(), large.memory_usage());
+    }
+
+    /* Object keys are hashed with a random seed. Keys that share a bucket
+     * under an unseeded hash, like STD::HASH, still both resolve.
+     */
+    {
+        constexpr size_t buckets = 64;
+        std::hash<std::string_view> unseeded {};
+        std::string first {}, second {};
+        for (size_t i = 1; second.empty(); i++) {
+            std::string key { "key" + std::to_string(i) };
+            if (unseeded(key) % buckets != unseeded("key0") % buckets)
+                continue;
+            (first.empty() ? first : second) = key;
+        }
+
+        std::string text { "{\"" + first + "\": 1, \"" + second + "\": 2}" };
+        FILE* text_stream = fmemopen(text.data(), text.size(), "r");
+        sjp::Parser text_parser { text_stream, &logger };
+        sjp::Json colliding { text_parser.parse() };
+        fclose(text_stream);
+        assert(colliding[first].get_number() == 1.0);
+        assert(colliding[second].get_number() == 2.0);
+        logger.log("`%s' and `%s' share a bucket under std::hash",
+                   first.c_str(), second.c_str());
+    }
+
+    /* Nesting doesn't cost any C++ stack, so the only limit on it is the
+     * one we choose with SET_MAX_DEPTH.
+     */
+    std::string deep(2000, '[');
+    deep.append(2000, ']');
+    FILE* deep_stream = fmemopen(deep.data(), deep.size(), "r");
+    parser.reset(deep_stream);
+    result = parser.try_parse();
+    assert(!result && result.error.code == sjp::ParseError::Code::TooDeep);
+    logger.log("recovered from error: %s", result.error.message.c_str());
+
+    rewind(deep_stream);
+    parser.reset(deep_stream);
+    parser.set_max_depth(deep.size() / 2);
+    result = parser.try_parse();
+    assert(result && result.json.to_string(sjp::Style::Compact) == deep);
+    fclose(deep_stream);
+
+    /* The same goes for the size of documents, strings, numbers and objects.
+     * Once a parse exceeds one of SJP::LIMITS, it doesn't read any further.
+     */
+    sjp::Limits limits { parser.get_limits() };
+    limits.string_length = 16;
+    parser.set_limits(limits);
+
+    char chatty[] = "{\"status\": \"this is more than we asked for\"}";
+    FILE* chatty_stream = fmemopen(chatty, sizeof chatty - 1, "r");
+    parser.reset(chatty_stream);
+    result = parser.try_parse();
+    assert(!result &&
+           result.error.code == sjp::ParseError::Code::StringTooLong);
+    logger.log("recovered from error: %s", result.error.message.c_str());
+    fclose(chatty_stream);
+
+    /* Reading never modifies a document, so any number of threads may query
+     * it at the same time without locking. SJP::SHAREDJSON keeps it alive
+     * for as long as any of them holds a (cheap) copy of the handle.
+     */
+    sjp::SharedJson shared { std::move(json) };
+    std::atomic<size_t> found { 0 };
+    std::vector<std::thread> readers {};
+
+    /* IO::ASYNCLOGGER leaves writing to a background thread, so the readers
+     * don't wait for each other (or for stderr) when they log.
+     */
+    io::AsyncLogger async_logger { *argv, stderr };
+    async_logger.set_level(io::Level::Warn);
+    for (size_t i = 0; i < 8; i++)
+        readers.emplace_back([shared, &ptr, &found, &async_logger, i](void) {
+            const sjp::JsonValue& nested { shared["data"]["deeply"]["nested"] };
+            if (nested[1].get_number() == 4230.0 &&
+                ptr->resolve_number(shared.get()) == 4230.0 &&
+                shared["format"]["width"].get_number() == 1920.0)
+                found++;
+            else
+                async_logger.warn("reader %ld saw a different document", i);
+        });
+    for (std::thread& t: readers) t.join();
+    assert(found == readers.size());
+    logger.log("%ld concurrent readers saw the same document", found.load());
+
+    /* If the background thread can't keep up, messages are dropped rather
+     * than blocking anyone, but the logger tells us how many. Once it's gone,
+     * every message has either been written or counted.
+     */
+    char*  log_text = nullptr;
+    size_t log_size = 0;
+    FILE*  log_stream = open_memstream(&log_text, &log_size);
+    const size_t per_thread = 4 * io::AsyncLogger::SLOTS;
+    [[maybe_unused]] size_t sent = 0;
+    {
+        io::AsyncLogger busy_logger { *argv, log_stream };
+        if (busy_logger.enabled(io::Level::Log)) sent = 4 * per_thread;
+        std::vector<std::thread> writers {};
+        for (size_t i = 0; i < 4; i++)
+            writers.emplace_back([&busy_logger, per_thread, i](void) {
+                for (size_t j = 0; j < per_thread; j++)
+                    busy_logger.log("writer %ld, message %ld", i, j);
+            });
+        for (std::thread& t: writers) t.join();
+    }
+    fclose(log_stream);
+
+    // The logger reports drops in lines of their own.
+    size_t lines = 0, dropped = 0, n = 0;
+    for (char* l = log_text; (l = strchr(l, '\n')); l++) lines++;
+    for (char* l = log_text; (l = strstr(l, "dropped ")); l++) {
+        if (sscanf(l, "dropped %zu messages", &n) != 1) continue;
+        dropped += n;
+        lines--;
+    }
+    assert(lines + dropped == sent);
+    logger.log("async logger wrote %ld messages and dropped %ld", lines,
+               dropped);
+    free(log_text);
 
     fclose(stream);
 
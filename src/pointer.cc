@@ -0,0 +1,124 @@
+/* Implementation of SJP::POINTER, see ``pointer.hh''.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <charconv>
+
+#include "pointer.hh"
+
+/* Array indices are plain decimal numbers without leading zeros (RFC 6901,
+ * section 4). Anything else, including `-', can only name an object member.
+ */
+static std::optional<size_t> to_index(std::string_view s)
+{
+    if (s.empty() || (s.size() > 1 && s[0] == '0')) return std::nullopt;
+
+    size_t i = 0;
+    auto [p, ec] = std::from_chars(s.data(), s.data()+s.size(), i);
+    if (ec != std::errc {} || p != s.data()+s.size()) return std::nullopt;
+    return i;
+}
+
+std::optional<sjp::Pointer> sjp::Pointer::compile(std::string_view s)
+{
+    Pointer ptr {};
+    if (s.empty()) return ptr;
+    if (s[0] != '/') return std::nullopt;
+
+    size_t start = 1;
+    while (true) {
+        size_t end = s.find('/', start);
+        if (end == std::string_view::npos) end = s.size();
+
+        std::string name {};
+        for (size_t i = start; i < end; i++) {
+            if (s[i] != '~') { name += s[i]; continue; }
+            if (i+1 == end)  return std::nullopt;
+            switch (s[++i]) {
+            case '0': name += '~'; break;
+            case '1': name += '/'; break;
+            default: return std::nullopt;
+            }
+        }
+
+        size_t hash = KeyHash {}(name);
+        std::optional<size_t> index = to_index(name);
+        ptr.segments.push_back(Segment { std::move(name), hash, index });
+
+        if (end == s.size()) break;
+        start = end+1;
+    }
+
+    return ptr;
+}
+
+const sjp::JsonValue& sjp::Pointer::step(const JsonValue& cur,
+                                         const Segment& seg)
+{
+    switch (cur.get_type()) {
+    case Type::Object:
+        return static_cast<const JsonObject&>(cur).get(seg.key());
+    case Type::Array:
+        if (!seg.index) return default_json_none;
+        return cur[*seg.index];
+    default:
+        return default_json_none;
+    }
+}
+
+/* The items of a numeric array are numbers, so no path goes on below them.
+ * We can tell that without indexing the array, which would create them.
+ */
+const sjp::JsonValue& sjp::Pointer::parent(const JsonValue& root) const
+{
+    const JsonValue* cur = &root;
+
+    for (size_t i = 0; i+1 < segments.size(); i++) {
+        if (cur->get_numbers()) return default_json_none;
+        cur = &step(*cur, segments[i]);
+    }
+
+    return *cur;
+}
+
+const sjp::JsonValue& sjp::Pointer::resolve(const JsonValue& root) const
+{
+    if (segments.empty()) return root;
+    return step(parent(root), segments.back());
+}
+
+const sjp::JsonValue& sjp::Pointer::resolve(const Json& json) const
+{
+    return resolve(json.get_root());
+}
+
+std::optional<double> sjp::Pointer::resolve_number(const JsonValue& root) const
+{
+    if (segments.empty()) return root.get_number();
+
+    const JsonValue& p    = parent(root);
+    const Segment&   last = segments.back();
+    if (std::optional<std::span<const double>> nums = p.get_numbers()) {
+        if (!last.index || *last.index >= nums->size()) return std::nullopt;
+        return (*nums)[*last.index];
+    }
+    return step(p, last).get_number();
+}
+
+std::optional<double> sjp::Pointer::resolve_number(const Json& json) const
+{
+    return resolve_number(json.get_root());
+}
@@ -0,0 +1,80 @@
+/* SJP::POINTER implements JSON Pointers (RFC 6901), e.g. `/data/deeply/0'.
+ * A pointer is compiled once from its string form and can then be resolved
+ * against any number of JSON objects.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef _POINTER_HH_
+#define _POINTER_HH_
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.hh"
+#include "sjp.hh"
+
+namespace sjp {
+    class Pointer;
+}
+
+/* Compiling splits the pointer into segments, undoes the `~0'/`~1' escapes,
+ * hashes every segment and parses those that look like array indices. Thus,
+ * resolving doesn't hash or parse anything. It doesn't allocate either,
+ * unless RESOLVE has to return an item of a numeric array: like
+ * OPERATOR[], that creates the array's JSONNUMBERs (once). RESOLVE_NUMBER
+ * reads such items straight from the array.
+ */
+class sjp::Pointer {
+public:
+    struct Segment {
+        std::string           name;
+        size_t                hash;
+        std::optional<size_t> index; // set if NAME is a valid array index
+
+        HashedKey key(void) const { return HashedKey { name, hash }; }
+    };
+
+private:
+    std::vector<Segment> segments = {};
+
+    Pointer(void) {}
+
+    static const JsonValue& step(const JsonValue&, const Segment&);
+    // Where all segments but the last one lead to.
+    const JsonValue& parent(const JsonValue&) const;
+
+public:
+    // Fails if the string is neither empty nor starts with a `/'.
+    static std::optional<Pointer> compile(std::string_view);
+
+    std::span<const Segment> get_segments(void) const { return segments; }
+    size_t                   size(void) const { return segments.size(); }
+
+    /* Gives JSONNONE if there is no value at this location. The empty
+     * pointer refers to the whole document.
+     */
+    const JsonValue& resolve(const JsonValue&) const;
+    const JsonValue& resolve(const Json&) const;
+
+    // Gives nothing if there is no number at this location.
+    std::optional<double> resolve_number(const JsonValue&) const;
+    std::optional<double> resolve_number(const Json&) const;
+};
+
+#endif /* _POINTER_HH_ */
@@ -0,0 +1,97 @@
+/* Finding the next byte of interest in a run of text, which is what the
+ * skipper, SJP::VALIDATE and SJP::OUTBUFFER spend most of their time on.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef _SCAN_HH_
+#define _SCAN_HH_
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "common.hh"
+
+namespace sjp {
+    // The kinds of bytes that SJP::FIND_SPECIAL stops at, to be combined.
+    constexpr unsigned SCAN_QUOTE     = 1 << 0;
+    constexpr unsigned SCAN_BACKSLASH = 1 << 1;
+    constexpr unsigned SCAN_CONTROL   = 1 << 2; // below 0x20
+    constexpr unsigned SCAN_NON_ASCII = 1 << 3; // 0x80 and above
+    constexpr unsigned SCAN_BRACKET   = 1 << 4; // `{', `}', `[' and `]'
+
+    inline bool is_special(unsigned char c, unsigned what)
+    {
+        // Setting bit 5 maps `[' to `{' and `]' to `}' (and nothing else).
+        unsigned char b = c | 0x20;
+        return ((what & SCAN_QUOTE)     && c == '"')  ||
+               ((what & SCAN_BACKSLASH) && c == '\\') ||
+               ((what & SCAN_CONTROL)   && c < 0x20)  ||
+               ((what & SCAN_NON_ASCII) && c >= 0x80) ||
+               ((what & SCAN_BRACKET)   && (b == '{' || b == '}'));
+    }
+
+    /* Offset of the first byte in P[0, N) that is one of WHAT, or N if there
+     * is none. With SSE2, we check 16 bytes at a time. Called with a
+     * constant WHAT, everything that isn't asked for is compiled out.
+     */
+    inline size_t find_special(const char* p, size_t n, unsigned what)
+    {
+        size_t i = 0;
+
+#ifdef __SSE2__
+        const __m128i quote     = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i ctrl_max  = _mm_set1_epi8(0x1f);
+        const __m128i bit5      = _mm_set1_epi8(0x20);
+        const __m128i open      = _mm_set1_epi8('{');
+        const __m128i close     = _mm_set1_epi8('}');
+
+        for (; i+16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p+i));
+            __m128i hits = _mm_setzero_si128();
+
+            if (what & SCAN_QUOTE)
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(v, quote));
+            if (what & SCAN_BACKSLASH)
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(v, backslash));
+            if (what & SCAN_CONTROL) {
+                // A saturated V-0x1F is zero exactly for the control chars.
+                __m128i ctrl = _mm_subs_epu8(v, ctrl_max);
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(ctrl,
+                                                         _mm_setzero_si128()));
+            }
+            if (what & SCAN_BRACKET) {
+                __m128i w = _mm_or_si128(v, bit5);
+                hits = _mm_or_si128(hits,
+                                    _mm_or_si128(_mm_cmpeq_epi8(w, open),
+                                                 _mm_cmpeq_epi8(w, close)));
+            }
+
+            int mask = _mm_movemask_epi8(hits);
+            // Non-ASCII bytes have their top bit set, which is what we collect.
+            if (what & SCAN_NON_ASCII) mask |= _mm_movemask_epi8(v);
+            if (mask != 0) return i + static_cast<size_t>(__builtin_ctz(mask));
+        }
+#endif
+
+        for (; i < n; i++)
+            if (is_special(static_cast<unsigned char>(p[i]), what)) break;
+        return i;
+    }
+}
+
+#endif /* _SCAN_HH_ */
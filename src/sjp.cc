@@ -18,9 +18,14 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 #include <algorithm>
+#include <charconv>
 #include <cmath>
+#include <cstdarg>
+#include <cstring>
 
 #include "common.hh"
+#include "pointer.hh"
+#include "scan.hh"
 #include "sjp.hh"
 
 [[noreturn]] static void fail(const char* msg, int code)
@@ -29,13 +34,16 @@
     exit(code);
 }
 
-static std::string padding(size_t size)
+static bool valid_in_number(char c)
 {
-    return std::string(size*2, ' ');
+    return (c >= '0' && c <= '9') || c == '-';
 }
 
+// Lets us combine a bunch of lambdas into a single overloaded callable.
+template<typename... Fs> struct overloaded : Fs... { using Fs::operator()...; };
+
 sjp::Parser::Parser(FILE* is, const io::Logger* log)
-    : in_stream { is }, logger { log }, unget_queue {}
+    : in_stream { is }, logger { log }
 {
     // We heavily rely on this pointer _not_ being NULL. Be sure to check that.
     if (!logger)           fail("logger must not be NULL", 1);
@@ -46,7 +54,9 @@ sjp::Parser::Parser(FILE* is, const io::Logger* log)
 
 sjp::Parser::Parser(const Parser& other) noexcept
     : in_stream { other.in_stream }, logger { other.logger },
-      unget_queue { other.unget_queue }, cursor { other.cursor }
+      buf { other.buf }, pos { other.pos }, len { other.len },
+      base { other.base }, cursor { other.cursor }, stats { other.stats },
+      limits { other.limits }
 {
 }
 
@@ -65,105 +75,534 @@ sjp::Parser& sjp::Parser::operator=(Parser rhs) noexcept
 // Since JSON is so easy, we don't lex the input first.
 sjp::Json sjp::Parser::parse(void)
 {
-    JsonValue* root = json();
+    begin(false);
+    return Json { parse_root(Projection {}) };
+}
+
+/* A projected parse only builds the values on (or below) the given paths,
+ * everything else is skipped. The resulting JSON object can be queried with
+ * the same paths, i.e. array items keep their positions. If none of the
+ * paths exist in the input, the result is empty.
+ */
+sjp::Json sjp::Parser::parse(std::span<const Pointer> ps, bool early)
+{
+    begin(false);
+    Json json { parse_root(project(ps, early)) };
+    paths = nullptr;
+
+    return json;
+}
+
+sjp::ParseResult sjp::Parser::try_parse(void)
+{
+    begin(true);
+    Json json { parse_root(Projection {}) };
+    recoverable = false;
+
+    return ParseResult { std::move(json), std::move(last_error) };
+}
+
+sjp::ParseResult sjp::Parser::try_parse(std::span<const Pointer> ps,
+                                        bool early)
+{
+    begin(true);
+    Json json { parse_root(project(ps, early)) };
+    paths       = nullptr;
+    recoverable = false;
+
+    return ParseResult { std::move(json), std::move(last_error) };
+}
+
+void sjp::Parser::reset(FILE* is)
+{
+    in_stream = is;
+    pos = len = base = 0;
+    cursor = {};
+}
 
-    if (char c = get_char(); c != EOF)
-        logger->warn("expected EOF after top-level JSON object, got `%c' "
-                     "at %s", c, cursor.to_string().c_str());
-    else
+// Every parse starts from a clean slate, no matter how the last one ended.
+void sjp::Parser::begin(bool recover)
+{
+    recoverable = recover;
+    last_error  = ParseError {};
+    paths       = nullptr;
+    wanted      = 0;
+    found       = 0;
+    stop_early  = false;
+    stopped     = false;
+    warnings    = {};
+    start       = base+pos;
+    nodes       = 0;
+
+    if (!in_stream)
+        error(ParseError::Code::ReadError, "input stream is NULL");
+}
+
+sjp::Parser::Projection sjp::Parser::project(std::span<const Pointer> ps,
+                                             bool early)
+{
+    if (ps.size() > MAX_PATHS)
+        error(ParseError::Code::TooManyPaths,
+              "cannot project more than %ld paths, got %ld",
+              MAX_PATHS, ps.size());
+
+    Projection proj { false, 0, 0, 0 };
+    for (size_t i = 0; i < std::min(ps.size(), MAX_PATHS); i++) {
+        uint64_t bit = uint64_t { 1 } << i;
+        if (ps[i].size() == 0) { proj.all = true; proj.ends |= bit; }
+        else                   proj.live |= bit;
+    }
+
+    paths      = ps.data();
+    wanted     = proj.live | proj.ends;
+    stop_early = early;
+
+    return proj;
+}
+
+// Gives NULL if there was an error. Nothing that was read is kept then.
+sjp::JsonValue* sjp::Parser::parse_root(Projection proj)
+{
+    uint64_t t0 = 0;
+    with_stats([this, &t0](ParseStats& st) { st = ParseStats {}; t0 = now(); });
+
+    // REFILL only catches documents that are too large a block at a time.
+    JsonValue* root = failed() ? nullptr : json(proj);
+    if (!failed() && base+pos - start > limits.bytes)
+        error(ParseError::Code::DocumentTooLarge,
+              "document longer than %ld bytes at %s", limits.bytes,
+              cursor.to_string().c_str());
+    report_warnings();
+    with_stats([this, t0](ParseStats& st) {
+        st.bytes    = base+pos - start;
+        st.total_ns = now() - t0;
+    });
+
+    if (failed()) {
+        delete root;
+        return nullptr;
+    }
+
+    if (stopped) {
+        if (logger->enabled(io::Level::Log))
+            logger->log("sjp parser stopped early, all paths found at %s",
+                        cursor.to_string().c_str());
+    } else if (char c = get_char(); c != EOF) {
+        if (logger->enabled(io::Level::Warn))
+            logger->warn("expected EOF after top-level JSON object, got `%c' "
+                         "at %s", c, cursor.to_string().c_str());
+    } else if (logger->enabled(io::Level::Log)) {
         logger->log("sjp parser ran successfully (%ld line%s read)",
                     cursor.line_no, cursor.line_no > 1 ? "s" : "");
+    }
+
+    return root;
+}
+
+// LINE, COLUMN and OFFSET point at where the problem starts.
+void sjp::Parser::warn(Warning kind, size_t line, size_t column, size_t offset,
+                       std::string_view what)
+{
+    if (!logger->enabled(io::Level::Warn)) return;
+
+    WarningSummary& w = warnings[static_cast<size_t>(kind)];
+    if (w.count++ > 0) return;
+    w = WarningSummary { 1, line, column, offset, std::string { what } };
+}
+
+void sjp::Parser::report_warnings(void)
+{
+    auto get = [this](Warning kind) -> const WarningSummary& {
+        return warnings[static_cast<size_t>(kind)];
+    };
+
+    if (const WarningSummary& w = get(Warning::DuplicateKey); w.count == 1)
+        logger->warn("ignoring duplicate key `%s' at %ld:%ld (offset %ld)",
+                     w.what.c_str(), w.line, w.column, w.offset);
+    else if (w.count > 1)
+        logger->warn("ignoring %ld duplicate keys, first `%s' at %ld:%ld "
+                     "(offset %ld)", w.count, w.what.c_str(), w.line,
+                     w.column, w.offset);
+
+    if (const WarningSummary& w = get(Warning::InvalidEscape); w.count == 1)
+        logger->warn("invalid escape sequence `\\%s' at %ld:%ld (offset %ld)",
+                     w.what.c_str(), w.line, w.column, w.offset);
+    else if (w.count > 1)
+        logger->warn("%ld invalid escape sequences, first `\\%s' at %ld:%ld "
+                     "(offset %ld)", w.count, w.what.c_str(), w.line,
+                     w.column, w.offset);
+}
+
+/* Every error in the input ends up here. Unless we parse recoverably, that's
+ * the end of the process. Otherwise, we keep the first error and stop: the
+ * input looks like it ended and every caller unwinds like it does when we
+ * stop early. PARSE_ROOT then frees whatever was built.
+ */
+void sjp::Parser::verror(size_t offset, ParseError::Code code,
+                         const char* fmt, va_list ap)
+{
+    char msg[256];
+    vsnprintf(msg, sizeof msg, fmt, ap);
+
+    if (!recoverable) logger->error("%s", msg);
+    if (failed())     return;
+
+    last_error = ParseError {
+        code, offset, cursor.line_no, cursor.char_no, msg
+    };
+    stopped = true;
+    pos     = len;
+}
+
+void sjp::Parser::error(ParseError::Code code, const char* fmt, ...)
+{
+    size_t offset = doc_offset();
+    if (code != ParseError::Code::UnexpectedEof && offset > 0) offset--;
+
+    va_list ap;
+    va_start(ap, fmt);
+    verror(offset, code, fmt, ap);
+    va_end(ap);
+}
+
+void sjp::Parser::error_at(size_t offset, ParseError::Code code,
+                           const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    verror(offset, code, fmt, ap);
+    va_end(ap);
+}
 
-    return sjp::Json(root);
+// Every value that we build counts towards LIMITS.NODES.
+void sjp::Parser::count_node(void)
+{
+    if (++nodes > limits.nodes)
+        error(ParseError::Code::TooManyNodes, "more than %ld values at %s",
+              limits.nodes, cursor.to_string().c_str());
 }
 
-sjp::JsonValue* sjp::Parser::json(void)
+// Every node of the tree is created in here, which is where we count them.
+template<typename T> T* sjp::Parser::make_node(size_t line, size_t column)
 {
-    JsonValue* elem = element();
+    count_node();
+    T* node = new T(line, column);
+    with_stats([node](ParseStats& st) {
+        st.nodes[static_cast<size_t>(node->get_type())]++;
+        st.allocations++;
+        st.allocated_bytes += sizeof(T);
+    });
+    return node;
+}
+
+uint64_t sjp::Parser::now(void) const
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(
+        steady_clock::now().time_since_epoch()).count();
+}
+
+/* Called after a value has been read completely. If it was the last one we
+ * were looking for, we can stop. A value that is wanted as a whole contains
+ * the LIVE paths that go on below it, too (e.g. `/a/b' if we also want
+ * `/a'), so they're found along with it.
+ */
+void sjp::Parser::found_value(Projection proj)
+{
+    uint64_t done = proj.ends | (proj.all ? proj.live : 0);
+    if (!done) return;
+    found |= done;
+    if (stop_early && found == wanted) stopped = true;
+}
+
+sjp::Parser::Projection sjp::Parser::descend(Projection proj,
+                                             std::string_view key)
+{
+    // Children of a wanted value are wanted, but aren't the end of any path.
+    if (proj.all) return Projection { true, 0, proj.depth+1, 0 };
+
+    Projection child { false, 0, proj.depth+1, 0 };
+    size_t hash = KeyHash {}(key);
+    for (size_t i = 0; i < MAX_PATHS; i++) {
+        if (!(proj.live & (uint64_t { 1 } << i))) continue;
+
+        const Pointer::Segment& seg = paths[i].get_segments()[proj.depth];
+        if (seg.hash != hash || seg.name != key) continue;
+
+        uint64_t bit = uint64_t { 1 } << i;
+        if (paths[i].size() > child.depth) { child.live |= bit; continue; }
+        child.all   = true;
+        child.ends |= bit;
+    }
+    return child;
+}
+
+sjp::Parser::Projection sjp::Parser::descend(Projection proj, size_t index)
+{
+    // Children of a wanted value are wanted, but aren't the end of any path.
+    if (proj.all) return Projection { true, 0, proj.depth+1, 0 };
+
+    Projection child { false, 0, proj.depth+1, 0 };
+    for (size_t i = 0; i < MAX_PATHS; i++) {
+        if (!(proj.live & (uint64_t { 1 } << i))) continue;
+
+        const Pointer::Segment& seg = paths[i].get_segments()[proj.depth];
+        if (seg.index != index) continue;
+
+        uint64_t bit = uint64_t { 1 } << i;
+        if (paths[i].size() > child.depth) { child.live |= bit; continue; }
+        child.all   = true;
+        child.ends |= bit;
+    }
+    return child;
+}
+
+sjp::JsonValue* sjp::Parser::json(Projection proj)
+{
+    JsonValue* elem = element(proj);
     return elem;
 }
 
-sjp::JsonValue* sjp::Parser::element(void)
+sjp::JsonValue* sjp::Parser::element(Projection proj)
 {
-    JsonValue* val = value();
+    JsonValue* val = value(proj);
     return val;
 }
 
-sjp::JsonValue* sjp::Parser::value(void)
+/* Reads a value and everything nested in it. Containers are opened when we
+ * see them and pushed onto FRAMES, then we go on with their first item. Once
+ * an item is complete, it goes into the innermost open container, and once
+ * that one is closed, it's complete itself. Gives NULL if PROJ says that the
+ * value isn't wanted.
+ */
+sjp::JsonValue* sjp::Parser::value(Projection proj)
 {
-    ws();
+    // Most documents never get anywhere near this deep.
+    frames.clear();
+    frames.reserve(std::min(limits.depth, size_t { 64 }));
 
-    auto valid_in_number = [](char c) -> bool
-    { return (c >= '0' && c <= '9') || c == '-'; };
-    char c = peek_char();
-    JsonValue* val = nullptr;
-
-    switch (c) {
-    case '{': val = object(); break;
-    case '[': val = array();  break;
-    case '"': val = string(); break;
-    case 't': val = true_();  break;
-    case 'f': val = false_(); break;
-    case 'n': val = null();   break;
-    default:
-        if (valid_in_number(c)) val = number();
-        else {
-            eat_char(); // so in case of EOF, we're at the correct LINE_NO
-            logger->error("expected value at %s", cursor.to_string().c_str());
+    for (;;) {
+        JsonValue* val    = nullptr;
+        bool       opened = false;
+
+        ws();
+        char c = peek_char();
+
+        // Only containers can lead to the values that some path points at.
+        bool wanted = proj.all || (proj.live != 0 && (c == '{' || c == '['));
+        if (!wanted) {
+            skip_value();
+        } else {
+            with_stats([proj](ParseStats& st) {
+                st.max_depth = std::max(st.max_depth, proj.depth);
+            });
+
+            switch (c) {
+            case '{': opened = open(true, proj, val);  break;
+            case '[': opened = open(false, proj, val); break;
+            case '"': val = string();                  break;
+            case 't': val = true_();                   break;
+            case 'f': val = false_();                  break;
+            case 'n': val = null();                    break;
+            default:
+                if (valid_in_number(c)) val = number();
+                else {
+                    eat_char(); // so on EOF, we're at the correct LINE_NO
+                    error(c == EOF ? ParseError::Code::UnexpectedEof
+                                   : ParseError::Code::UnexpectedChar,
+                          "expected value at %s", cursor.to_string().c_str());
+                }
+            }
+            if (!opened) found_value(proj);
         }
+
+        if (!opened) {
+            if (!stopped) ws();
+            if (frames.empty()) return val;
+            attach(frames.back(), val);
+        }
+
+        // Closing a container might complete its parent's item, too.
+        for (bool first = opened; !next_item(first, proj); first = false) {
+            JsonValue* node = frames.back().node;
+            Projection done = frames.back().proj;
+            frames.pop_back();
+
+            found_value(done);
+            if (!stopped) ws();
+            if (frames.empty()) return node;
+            attach(frames.back(), node);
+        }
+    }
+}
+
+/* Gives true if we've pushed a frame for the container, i.e. if it isn't
+ * empty. VAL is the new container, unless it's nested too deeply.
+ */
+bool sjp::Parser::open(bool object, Projection proj, JsonValue*& val)
+{
+    match_char(object ? '{' : '[');
+    if (frames.size() == limits.depth) {
+        error(ParseError::Code::TooDeep,
+              "containers nested deeper than %ld levels at %s", limits.depth,
+              cursor.to_string().c_str());
+        return false;
     }
 
+    if (object) val = make_node<JsonObject>(cursor.line_no, cursor.char_no);
+    else        val = make_node<JsonArray>(cursor.line_no, cursor.char_no);
+
     ws();
-    return val;
+    if (peek_char() == (object ? '}' : ']')) { eat_char(); return false; }
+
+    frames.push_back(Frame { val, proj, object });
+    return true;
 }
 
-sjp::JsonValue* sjp::Parser::object(void)
+/* Moves on to the next item of the innermost open container. FIRST is set if
+ * we've only just opened it. Gives false once it's closed (or we've stopped),
+ * otherwise PROJ is what the item's value is read with.
+ */
+bool sjp::Parser::next_item(bool first, Projection& proj)
 {
-    match_char('{');
-    JsonObject* obj = new JsonObject(cursor.line_no, cursor.char_no);
+    if (stopped) return false;
 
-    ws();
-    if (peek_char() == '}') { eat_char(); return obj; }
+    Frame& f = frames.back();
+    if (f.object) {
+        if (!first) {
+            if (peek_char() != ',') { match_char('}'); return false; }
+            eat_char();
+        }
 
-    bool done = false;
-    while (!done) {
         // We must be careful about whitespace.
         ws();
-        JsonString* str = static_cast<JsonString*>(string());
+        if (++f.index > limits.members) {
+            error(ParseError::Code::TooManyMembers,
+                  "object with more than %ld members at %s", limits.members,
+                  cursor.to_string().c_str());
+            return false;
+        }
+
+        f.line   = cursor.line_no;
+        f.column = cursor.char_no+1;
+        f.offset = doc_offset();
+        f.key.clear();
+        string_value(f.key, true);
 
         ws();
         match_char(':');
-        JsonValue* val = value(); // skips whitespace for us
-        obj->add_value(str->get_string_copy(), val, *logger);
-        delete str;
+        proj = descend(f.proj, f.key);
+        return true;
+    }
 
-        if (peek_char() == ',') eat_char();
-        else                    done = true;
+    JsonArray* arr = static_cast<JsonArray*>(f.node);
+    for (;; first = false) {
+        if (!first) {
+            if (peek_char() != ',') { match_char(']'); return false; }
+            eat_char();
+        }
+
+        /* While we've only seen numbers, they go straight into the array's
+         * contiguous storage and we never allocate a JSONNUMBER for them.
+         * That's cheap enough to do for unwanted numbers, too.
+         */
+        ws();
+        proj = descend(f.proj, f.index++);
+        if (!arr->numeric || !valid_in_number(peek_char())) return true;
+
+        count_node();
+        arr->add_number(number_value());
+        with_stats([proj](ParseStats& st) {
+            st.nodes[static_cast<size_t>(Type::Number)]++;
+            st.max_depth = std::max(st.max_depth, proj.depth);
+        });
+        found_value(proj);
+        if (stopped) return false;
+        ws();
+    }
+}
+
+// VAL is NULL if it was skipped. Arrays keep an empty slot for it, then.
+void sjp::Parser::attach(Frame& f, JsonValue* val)
+{
+    if (!f.object) {
+        static_cast<JsonArray*>(f.node)->add_value(val);
+        return;
     }
-    match_char('}');
 
-    return obj;
+    JsonObject* obj = static_cast<JsonObject*>(f.node);
+    if (val && !obj->add_value(std::move(f.key), val))
+        warn(Warning::DuplicateKey, f.line, f.column, f.offset, f.key);
 }
 
-sjp::JsonValue* sjp::Parser::array(void)
+/* Skips over the next value without building anything. We only track how
+ * deeply we're nested and whether we're inside of a string, so malformed
+ * content within the skipped value goes unnoticed. Everything in between
+ * the chars we care about is consumed in bulk, straight from BUF.
+ */
+void sjp::Parser::skip_value(void)
 {
-    match_char('[');
-    JsonArray* arr = new JsonArray(cursor.line_no, cursor.char_no);
+    auto is_delimiter = [](char c) -> bool {
+        return c == ',' || c == '}' || c == ']' || c == ' ' || c == '\t' ||
+               c == '\n' || c == '\r' || c == EOF;
+    };
+
+    uint64_t t0 = 0;
+    with_stats([this, &t0](ParseStats&) { t0 = now(); });
 
     ws();
-    if (peek_char() == ']') { eat_char(); return arr; }
+    size_t depth = 0;
+    bool in_string = false;
+
+    switch (get_char()) {
+    case '{': case '[':
+        depth = 1;
+        break;
+    case '"':
+        in_string = true;
+        break;
+    case '}': case ']':
+        error(ParseError::Code::UnexpectedChar,
+              "expected value at %s", cursor.to_string().c_str());
+        break;
+    case EOF:
+        error(ParseError::Code::UnexpectedEof,
+              "unexpected EOF at %s", cursor.to_string().c_str());
+        break;
+    default:
+        // A literal or number, which is short enough to go char by char.
+        while (!is_delimiter(peek_char())) eat_char();
+    }
 
-    bool done = false;
-    while (!done) {
-        JsonValue* val = value(); // skips whitespace already
-        arr->add_value(val);
+    while (depth > 0 || in_string) {
+        if (pos == len && !refill()) {
+            eat_char(); // so we report the correct LINE_NO
+            error(ParseError::Code::UnexpectedEof,
+                  in_string ? "unterminated string at %s"
+                            : "unexpected EOF at %s",
+                  cursor.to_string().c_str());
+            return;
+        }
 
-        if (peek_char() == ',') eat_char();
-        else                    done = true;
+        /* Within strings, only quotes and backslashes matter to us, quotes and
+         * brackets otherwise.
+         */
+        advance(in_string ? find_special(buf.data()+pos, len-pos,
+                                         SCAN_QUOTE | SCAN_BACKSLASH)
+                          : find_special(buf.data()+pos, len-pos,
+                                         SCAN_QUOTE | SCAN_BRACKET));
+        if (pos == len) continue;
+
+        switch (get_char()) {
+        case '\\': eat_char();             break; // can't end the string
+        case '"':  in_string = !in_string; break;
+        case '{':  case '[': depth++;      break;
+        default:   depth--;                break; // `}' or `]'
+        }
     }
-    match_char(']');
+    ws();
 
-    return arr;
+    with_stats([this, t0](ParseStats& st) { st.skip_ns += now() - t0; });
 }
 
 // @TODO: For now, we just skip the 4 characters making up the code point.
@@ -179,13 +618,25 @@ char sjp::Parser::get_unicode_from_hex(void)
 // @TODO: We handle escapes in a very limited way, `\uXXXX' not supported.
 sjp::JsonValue* sjp::Parser::string(void)
 {
+    JsonString* str = make_node<JsonString>(cursor.line_no, cursor.char_no+1);
+    string_value(str->value, false);
+    return str;
+}
+
+/* KEY tells us which of the limits applies. It's checked against the input
+ * that we've read since the opening quote: escapes that add little or
+ * nothing to STR_VAL would otherwise let a string grow without bounds.
+ */
+void sjp::Parser::string_value(std::string& str_val, bool key)
+{
+    const size_t max = key ? limits.key_length : limits.string_length;
     match_char('"');
-    JsonString* str = new JsonString(cursor.line_no, cursor.char_no);
-    std::string str_val;
+    const size_t first = base + pos;
 
     char c = peek_char();
     while (c != '"' && c != EOF && c != '\n') {
         if (c == '\\') {
+            with_stats([](ParseStats& st) { st.escapes++; });
             eat_char();
             c = get_char();
             switch (c) {
@@ -201,19 +652,32 @@ sjp::JsonValue* sjp::Parser::string(void)
                 get_unicode_from_hex();
                 break;
             default:
-                logger->warn("invalid escape sequence \\%c", c);
+                warn(Warning::InvalidEscape, cursor.line_no, cursor.char_no-1,
+                     doc_offset()-2, std::string_view { &c, 1 });
             }
         } else {
             // If this is no escape sequence, we simply add C to the ouput.
             str_val += get_char();
         }
+
+        if (base + pos - first > max) {
+            error(key ? ParseError::Code::KeyTooLong
+                      : ParseError::Code::StringTooLong,
+                  "%s longer than %ld bytes at %s", key ? "key" : "string",
+                  max, cursor.to_string().c_str());
+            return;
+        }
         c = peek_char();
     }
     match_char('"');
 
-    str->add_value(str_val);
-
-    return str;
+    with_stats([&str_val](ParseStats& st) {
+        st.string_bytes += str_val.size();
+        if (size_t n = heap_bytes(str_val); n > 0) {
+            st.allocations++;
+            st.allocated_bytes += n;
+        }
+    });
 }
 
 /* NOTE: This routine is messy and might profit from cleanup. Also, some of the
@@ -223,116 +687,178 @@ sjp::JsonValue* sjp::Parser::string(void)
 sjp::JsonValue* sjp::Parser::number(void)
 {
     // We're still one char before this number.
-    JsonNumber* num = new JsonNumber(cursor.line_no, cursor.char_no+1);
+    JsonNumber* num = make_node<JsonNumber>(cursor.line_no, cursor.char_no+1);
+    num->add_value(number_value());
+    return num;
+}
 
-    auto   is_digit = [](char c) { return '0' <= c && c <= '9'; };
-    bool   negative = false;
-    double d_val    = 0.0;
-    char   c;
+/* While reading, we only check the syntax and collect the literal. The
+ * conversion itself is left to STD::FROM_CHARS, which is correctly rounded
+ * (accumulating digits in a double is not), so numbers round-trip exactly.
+ */
+double sjp::Parser::number_value(void)
+{
+    auto is_digit = [](char c) { return '0' <= c && c <= '9'; };
+    char c;
+
+    with_stats([](ParseStats& st) { st.numbers++; });
+
+    /* The literal goes into a buffer on the stack, which holds every number
+     * that we print (17 significant digits plus sign, point and exponent)
+     * with room to spare. Only longer ones spill over into LONG_LIT.
+     */
+    char        lit[64];
+    size_t      n = 0;
+    std::string long_lit {};
+
+    // Once the literal gets too long, we only see EOF.
+    auto take = [this, &lit, &n, &long_lit](void) -> char {
+        char c = get_char();
+        if (n < sizeof lit) {
+            lit[n] = c;
+        } else {
+            if (n == sizeof lit) long_lit.assign(lit, n);
+            long_lit += c;
+        }
+        if (++n > limits.number_length)
+            error(ParseError::Code::NumberTooLong,
+                  "number literal longer than %ld chars at %s",
+                  limits.number_length, cursor.to_string().c_str());
+        return c;
+    };
 
-    c = get_char();
-    if (c == '-') { negative = true; c = get_char(); }
+    c = take();
+    if (c == '-') c = take();
 
     if ('1' <= c && c <= '9') {
-        d_val += c - '0';
-        while (is_digit(peek_char())) {
-            c = get_char();
-            d_val = d_val * 10 + (c - '0');
-        }
+        while (is_digit(peek_char())) c = take();
     } else if (c == '0') {
         // Go straight to exponent and fractional parts.
     } else {
         cursor.correct_for_reporting(c);
-        logger->error("expected a digit at %s", cursor.to_string().c_str());
+        error_at(doc_offset() - (c != EOF), ParseError::Code::InvalidNumber,
+                 "expected a digit at %s", cursor.to_string().c_str());
     }
 
-    size_t frac_size = 1;
     if (peek_char() == '.') {
-        eat_char();
-        while (is_digit(peek_char())) {
-            c = get_char();
-            d_val = d_val * 10 + (c - '0');
-            frac_size *= 10;
-        }
-        if (frac_size == 1) {
+        c = take();
+        bool any = false;
+        while (is_digit(peek_char())) { c = take(); any = true; }
+        if (!any) {
+            // The byte that isn't a digit is still ahead of us.
             cursor.correct_for_reporting(c);
-            logger->error("expected a digit after decimal point at %s",
-                          cursor.to_string().c_str());
+            error_at(doc_offset(), ParseError::Code::InvalidNumber,
+                     "expected a digit after decimal point at %s",
+                     cursor.to_string().c_str());
         }
     }
-    d_val = d_val / static_cast<double>(frac_size);
 
     if ((c = peek_char()) == 'E' || c == 'e') {
-        eat_char();
+        take();
 
-        c = get_char();
-        bool neg_expo = false;
-        if (c == '+' || c == '-') {
-            if (c == '-') neg_expo = true;
-            c = get_char();
-        }
+        c = take();
+        if (c == '+' || c == '-') c = take();
 
         if (c < '0' || c > '9') {
             cursor.correct_for_reporting(c);
-            logger->error("expected a digit in exponent at %s",
-                          cursor.to_string().c_str());
+            error_at(doc_offset() - (c != EOF), ParseError::Code::InvalidNumber,
+                     "expected a digit in exponent at %s",
+                     cursor.to_string().c_str());
         }
-        double expo = c - '0';
-        while (is_digit(peek_char())) {
-            c = get_char();
-            expo = expo * 10 + (c - '0');
-        }
-        if (neg_expo) expo *= -1;
-        d_val *= exp10(expo);
+        while (is_digit(peek_char())) c = take();
     }
 
-    if (negative) d_val *= -1;
-    num->add_value(d_val);
+    const char* first = n > sizeof lit ? long_lit.data() : lit;
+    double d_val = 0.0;
+    auto [_, ec] = std::from_chars(first, first+n, d_val);
+    // STRTOD gives us the correct infinity or zero for out-of-range values.
+    if (ec == std::errc::result_out_of_range)
+        d_val = strtod(std::string { first, n }.c_str(), 0);
 
-    return num;
+    return d_val;
 }
 
 sjp::JsonValue* sjp::Parser::true_(void)
 {
-    JsonTrue* true_ = new JsonTrue(cursor.line_no, cursor.char_no+1);
+    JsonTrue* true_ = make_node<JsonTrue>(cursor.line_no, cursor.char_no+1);
     match_string("true");
     return true_;
 }
 
 sjp::JsonValue* sjp::Parser::false_(void)
 {
-    JsonFalse* false_ = new JsonFalse(cursor.line_no, cursor.char_no+1);
+    JsonFalse* false_ = make_node<JsonFalse>(cursor.line_no, cursor.char_no+1);
     match_string("false");
     return false_;
 }
 
 sjp::JsonValue* sjp::Parser::null(void)
 {
-    JsonNull* null_ = new JsonNull(cursor.line_no, cursor.char_no+1);
+    JsonNull* null_ = make_node<JsonNull>(cursor.line_no, cursor.char_no+1);
     match_string("null");
     return null_;
 }
 
-/* Since <stdio.h> buffers input, we won't do that (for now). At some point, we
- * might want to get rid of that level of indirection and read directly from a
- * file descriptor.
- * Some algorithmic subtlety comes from the fact that EOF on a line by itself
- * doesn't count as a line. Thus, we have to specifically handle that case.
+/* Gives false if IN_STREAM has nothing left. Only called once everything in
+ * BUF has been consumed. Once we've stopped, we don't read anything anymore.
  */
-[[nodiscard]] char sjp::Parser::get_char(void)
+bool sjp::Parser::refill(void)
 {
-    char c;
+    if (stopped) return false;
+    if (buf.empty()) buf.resize(BLOCK_SIZE);
+
+    // We've consumed all of BUF, so we know that much belongs to the document.
+    if (base+len - start > limits.bytes) {
+        error(ParseError::Code::DocumentTooLarge,
+              "document longer than %ld bytes at %s", limits.bytes,
+              cursor.to_string().c_str());
+        return false;
+    }
 
-    if (unget_queue.size() > 0) {
-        c = unget_queue.front();
-        unget_queue.pop();
-    } else {
-        size_t cnt = fread(&c, 1, 1, in_stream);
-        if (cnt != 1) {
-            if (feof(in_stream))   c = EOF;
-            if (ferror(in_stream)) logger->error("unable to read from stream");
-        }
+    uint64_t t0 = 0;
+    with_stats([this, &t0](ParseStats&) { t0 = now(); });
+
+    base += len;
+    pos = 0;
+    len = fread(buf.data(), 1, buf.size(), in_stream);
+    with_stats([this, t0](ParseStats& st) { st.read_ns += now() - t0; });
+    if (len == 0 && ferror(in_stream))
+        error(ParseError::Code::ReadError, "unable to read from stream");
+    return len > 0;
+}
+
+/* Consumes the next N bytes of BUF in one go, which must not contain EOF. We
+ * only need to look at newlines to keep the cursor correct.
+ */
+void sjp::Parser::advance(size_t n)
+{
+    const char* p = buf.data() + pos;
+    const char* end = p + n;
+    const char* last = nullptr; // the last two newlines in P[0, N)
+    const char* prev = nullptr;
+
+    for (const char* q = p;
+         (q = static_cast<const char*>(memchr(q, '\n', end-q))); q++) {
+        cursor.line_no++;
+        prev = last;
+        last = q;
+    }
+    pos += n;
+
+    if (!last) {
+        cursor.char_no += n;
+        return;
     }
+    cursor.prev_line_len = prev ? last-prev-1 : cursor.char_no + (last-p);
+    cursor.char_no = end - (last+1);
+}
+
+/* Some algorithmic subtlety comes from the fact that EOF on a line by itself
+ * doesn't count as a line. Thus, we have to specifically handle that case.
+ */
+[[nodiscard]] char sjp::Parser::get_char(void)
+{
+    char c = (pos < len || refill()) ? buf[pos++] : EOF;
 
     if (c == '\n') {
         cursor.increment_line();
@@ -360,139 +886,416 @@ void sjp::Parser::match_char(char e)
     char c = get_char();
     if (c != e) {
         cursor.correct_for_reporting(c);
-        if (c == EOF)  logger->error("expected `%c', got EOF at %s",
-                                     e, cursor.to_string().c_str());
-        if (c == '\n') logger->error("expected `%c', got NL at %s",
-                                     e, cursor.to_string().c_str());
-        logger->error("expected `%c', got `%c' at %s",
-                      e, c, cursor.to_string().c_str());
+        if (c == EOF)
+            error(ParseError::Code::UnexpectedEof,
+                  "expected `%c', got EOF at %s",
+                  e, cursor.to_string().c_str());
+        else if (c == '\n')
+            error(ParseError::Code::UnexpectedChar,
+                  "expected `%c', got NL at %s",
+                  e, cursor.to_string().c_str());
+        else
+            error(ParseError::Code::UnexpectedChar,
+                  "expected `%c', got `%c' at %s",
+                  e, c, cursor.to_string().c_str());
     }
 }
 
+// A misspelled literal is blamed on its first byte, like SJP::VALIDATE does.
 void sjp::Parser::match_string(const char* s)
 {
+    const size_t first = doc_offset();
     char c;
     const char* p;
     for (p = s; *p && ((c = get_char()) == *p); p++)
         ;
 
     if (*p != '\0') {
-        char* copy = strdup(s);
-        size_t offset = p - s;
-        copy[offset] = c;
-        copy[offset+1] = '\0';
-        logger->error("got invalid `%s', maybe misspelling of `%s' at %s",
-                      copy, s, cursor.to_string().c_str());
+        std::string copy { s, static_cast<size_t>(p-s) };
+        copy += c;
+        error_at(first, ParseError::Code::InvalidLiteral,
+                 "got invalid `%s', maybe misspelling of `%s' at %s",
+                 copy.c_str(), s, cursor.to_string().c_str());
     }
 }
 
-/* Peeking is implemented in the most straight-forward way: we get N chars from
- * the input stream, put them onto UNGET_QUEUE and return the n'th char to the
- * caller. Thus, the next call to GET_CHAR will return the correct ordering of
- * characters. An edge case is the end of the stream. We might end up with N
- * EOF symbols on UNGET_QUEUE.
- */
-[[nodiscard]] char sjp::Parser::peek_char(size_t n)
+// Peeking doesn't consume anything, so the cursor stays where it is.
+[[nodiscard]] char sjp::Parser::peek_char(void)
 {
+    return (pos < len || refill()) ? buf[pos] : EOF;
+}
+
+// Advance the stream to the next non-whitespace character.
+void sjp::Parser::ws(void)
+{
+    auto is_whitespace = [](char c) -> bool
+    { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+
     char c;
-    std::vector<char> local_queue;
+    while ((c = peek_char()) != EOF && is_whitespace(c))
+        eat_char();
+}
 
-    while (n--) {
-        c = get_char();
-        local_queue.push_back(c);
+// Only hashes NAME once, no matter if it's a duplicate or not.
+bool sjp::JsonObject::add_value(std::string&& name, sjp::JsonValue* val)
+{
+    if (!values.try_emplace(name, val).second) {
+        delete val;
+        return false;
     }
 
-    for (char c: local_queue) unget_char(c);
-    return c;
+    names_in_order.push_back(std::move(name));
+    return true;
 }
 
-void sjp::Parser::unget_char(char c)
+/* The hash table's share follows the layout of libstdc++: a pointer per bucket
+ * (unless there's only one, which is stored inline) and a node per member.
+ * Nodes hold a pointer to the next one, the member and, if hashing might
+ * throw, its hash.
+ */
+size_t sjp::JsonObject::own_memory_usage(
+    std::vector<const JsonValue*>& children) const
 {
-    unget_queue.push(c);
-    if (c == '\n') {
-        cursor.char_no = cursor.prev_line_len;
-        cursor.line_no--;
-    } else if (c == EOF && cursor.char_no == 0) {
-        // We decremented the line number in GET_CHAR, so we reverse that.
-        cursor.line_no++;
-    } else {
-        cursor.char_no--;
+    constexpr bool cached =
+        !std::is_nothrow_invocable_v<const KeyHash&, const std::string&>;
+    constexpr size_t node = sizeof(void*) + sizeof(decltype(values)::value_type)
+                          + (cached ? sizeof(size_t) : 0);
+
+    size_t n = sizeof(*this) + names_in_order.capacity() * sizeof(std::string);
+    if (values.bucket_count() > 1) n += values.bucket_count() * sizeof(void*);
+
+    for (const auto& [name, val]: values) {
+        n += node + heap_bytes(name);
+        children.push_back(val);
     }
+    for (const std::string& name: names_in_order)
+        n += heap_bytes(name);
+    return n;
 }
 
-// Advance the stream to the next non-whitespace character.
-void sjp::Parser::ws(void)
+void sjp::JsonObject::serialize(OutBuffer& out, Style style, size_t d) const
 {
-    auto is_whitespace = [](char c) -> bool
-    { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+    serialize_tree(*this, out, style, d);
+}
 
-    char c;
-    while ((c = peek_char()) != EOF && is_whitespace(c))
-        eat_char();
+void sjp::JsonArray::serialize(OutBuffer& out, Style style, size_t d) const
+{
+    serialize_tree(*this, out, style, d);
 }
 
-void sjp::JsonObject::add_value(const std::string& name, sjp::JsonValue* val,
-                                const io::Logger& log)
+/* Like the parser, we keep the containers that we're in the middle of on a
+ * stack, together with the index of the next item to write. Everything else
+ * is written right away. ROOT is at depth D.
+ */
+void sjp::JsonValue::serialize_tree(const JsonValue& root, OutBuffer& out,
+                                    Style style, size_t d)
 {
-    if (values.find(name) != values.end()) {
-        log.warn("ignoring duplicate key `%s' at %ld:%ld",
-                 name.c_str(), line_no, char_no);
-    } else {
-        names_in_order.push_back(name);
-        values[name] = val;
+    struct Frame {
+        const JsonValue* node;
+        bool             object;
+        size_t           next;
+    };
+    std::vector<Frame> stack {};
+    const bool pretty = style == Style::Pretty;
+
+    // Non-empty containers only get their opening bracket.
+    auto begin = [&out, &stack, style](const JsonValue& v) {
+        Type t = v.get_type();
+        if (t != Type::Object && t != Type::Array) {
+            v.serialize(out, style, 0);
+        } else if (v.size() == 0) {
+            out.put(t == Type::Object ? "{}" : "[]");
+        } else {
+            out.put(t == Type::Object ? '{' : '[');
+            stack.push_back(Frame { &v, t == Type::Object, 0 });
+        }
+    };
+
+    begin(root);
+    while (!stack.empty()) {
+        Frame& f     = stack.back();
+        size_t depth = d + stack.size(); // of the items
+
+        if (f.next == f.node->size()) {
+            if (pretty) out.newline(depth-1);
+            out.put(f.object ? '}' : ']');
+            stack.pop_back();
+            continue;
+        }
+
+        size_t i = f.next++;
+        if (i > 0)  out.put(',');
+        if (pretty) out.newline(depth);
+
+        // BEGIN might push, which invalidates F.
+        if (f.object) {
+            const JsonObject& obj  { static_cast<const JsonObject&>(*f.node) };
+            const std::string& name { obj.names_in_order[i] };
+            out.put_string(name);
+            out.put(pretty ? ": " : ":");
+            begin(*obj.values.find(name)->second);
+        } else {
+            const JsonArray& arr { static_cast<const JsonArray&>(*f.node) };
+            if (arr.numeric)        out.put_number(arr.numbers[i]);
+            else if (arr.values[i]) begin(*arr.values[i]);
+            else                    out.put("null");
+        }
     }
 }
 
-void sjp::JsonObject::print(FILE* stream, size_t d)
+// Which order we visit the values in doesn't matter for a sum.
+size_t sjp::JsonValue::memory_tree(const JsonValue& root)
 {
-    fprintf(stream, "{\n");
-    for (size_t i = 0; i < names_in_order.size(); i++) {
-        const std::string& name { names_in_order[i] };
-        JsonValue* value = values[name];
-        fprintf(stream, "%s\"%s\": ", padding(d+1).c_str(), name.c_str());
-        value->print(stream, d+1);
-        if (i < names_in_order.size()-1) fprintf(stream, ",\n");
-        else                             fprintf(stream, "\n");
+    std::vector<const JsonValue*> pending { &root };
+    size_t n = 0;
+
+    while (!pending.empty()) {
+        const JsonValue* v = pending.back();
+        pending.pop_back();
+        n += v->own_memory_usage(pending);
     }
-    fprintf(stream, "%s}", padding(d).c_str());
+    return n;
 }
 
-void sjp::JsonArray::print(FILE* stream, size_t d)
+/* Deleting the children right away (their destructors do the same for their
+ * own children) is quicker than going through the worklist, so that's what
+ * we do for the first FREE_RECURSION levels. Below that, every container
+ * that we delete has been emptied onto the worklist before, so its
+ * destructor has nothing left to do. Children are pushed in reverse, which
+ * frees them in the order they were allocated in.
+ */
+void sjp::JsonValue::free_children(JsonValue& root)
 {
-    fprintf(stream, "[\n");
-    for (size_t i = 0; i < values.size(); i++) {
-        fprintf(stream, "%s", padding(d+1).c_str());
-        values[i]->print(stream, d+1);
-        if (i < values.size()-1) fprintf(stream, ",\n");
-        else                     fprintf(stream, "\n");
+    static constexpr size_t FREE_RECURSION = 64;
+    static thread_local size_t depth = 0;
+
+    std::vector<JsonValue*> pending {};
+    root.take_children(pending);
+
+    if (depth < FREE_RECURSION) {
+        depth++;
+        for (auto it = pending.rbegin(); it != pending.rend(); it++)
+            delete *it;
+        depth--;
+        return;
     }
-    fprintf(stream, "%s]", padding(d).c_str());
+
+    while (!pending.empty()) {
+        JsonValue* v = pending.back();
+        pending.pop_back();
+        v->take_children(pending);
+        delete v;
+    }
+}
+
+void sjp::JsonObject::take_children(std::vector<JsonValue*>& out)
+{
+    for (auto& [name, value]: values) out.push_back(value);
+    values.clear();
+    names_in_order.clear();
 }
 
-sjp::JsonValue& sjp::JsonObject::operator[](size_t i)
+// Items that a projected parse skipped are NULL, there's nothing to free.
+void sjp::JsonArray::take_children(std::vector<JsonValue*>& out)
+{
+    for (auto it = values.rbegin(); it != values.rend(); it++)
+        if (*it) out.push_back(*it);
+    values.clear();
+}
+
+const sjp::JsonValue& sjp::JsonObject::operator[](size_t i) const
 {
     if (names_in_order.size() <= i)
         return default_json_none;
     const std::string& name { names_in_order[i] };
-    return *(values[name]);
+    return *(values.find(name)->second);
 }
 
-sjp::JsonValue& sjp::JsonObject::operator[](const std::string& n)
+const sjp::JsonValue& sjp::JsonObject::operator[](const std::string& n) const
 {
-    if (values.find(n) == values.end())
+    auto it = values.find(n);
+    if (it == values.end())
         return default_json_none;
-    return *(values[n]);
+    return *(it->second);
 }
 
-sjp::JsonValue& sjp::JsonArray::operator[](size_t i)
+const sjp::JsonValue& sjp::JsonObject::get(const HashedKey& k) const
 {
-    if (values.size() <= i)
+    auto it = values.find(k);
+    if (it == values.end())
+        return default_json_none;
+    return *(it->second);
+}
+
+const sjp::JsonValue& sjp::JsonArray::operator[](size_t i) const
+{
+    if (size() <= i)
+        return default_json_none;
+    if (numeric) materialize();
+    if (!values[i])
         return default_json_none;
     return *(values[i]);
 }
 
 // @NOTE: Could it make sense to access arrays via strings?
-sjp::JsonValue& sjp::JsonArray::operator[](const std::string&)
+const sjp::JsonValue& sjp::JsonArray::operator[](const std::string&) const
 {
     return default_json_none;
 }
+
+/* The first non-number turns a numeric array into a regular one. The numbers
+ * we've collected up to that point must then become proper JSONNUMBERs.
+ */
+void sjp::JsonArray::add_value(sjp::JsonValue* v)
+{
+    if (numeric) {
+        materialize();
+        numeric = false;
+        numbers.clear();
+        numbers.shrink_to_fit();
+    }
+    values.push_back(v);
+}
+
+/* Numeric arrays only get JSONNUMBERs for their elements if a user asks for a
+ * JSONVALUE&. Since this is a lookup from the user's point of view, it must
+ * happen exactly once even if multiple threads index the array concurrently.
+ */
+void sjp::JsonArray::materialize(void) const
+{
+    std::call_once(materialized, [this](void) {
+        values.reserve(numbers.size());
+        for (double d: numbers) {
+            JsonNumber* num = new JsonNumber(line_no, char_no);
+            num->value = d;
+            values.push_back(num);
+        }
+        has_values.store(true, std::memory_order_release);
+    });
+}
+
+/* A numeric array's items might be materialized by another thread while we
+ * look at them. We only count them once that's done.
+ */
+size_t sjp::JsonArray::own_memory_usage(
+    std::vector<const JsonValue*>& children) const
+{
+    size_t n = sizeof(*this) + numbers.capacity() * sizeof(double);
+    if (numeric && !has_values.load(std::memory_order_acquire)) return n;
+
+    n += values.capacity() * sizeof(JsonValue*);
+    for (const JsonValue* v: values)
+        if (v) children.push_back(v);
+    return n;
+}
+
+/* Shared by the bulk extractors. CONVERT is called with either a double (for
+ * numeric arrays) or a JSONVALUE& and stores the item's value in its second
+ * argument. It returns false if the item has the wrong type.
+ */
+template<typename T, typename F>
+std::optional<std::vector<T>> sjp::JsonArray::extract(Mismatch policy,
+                                                      const T& dflt,
+                                                      F convert) const
+{
+    std::vector<T> out;
+    out.reserve(size());
+
+    auto push = [&](bool ok, const T& v) -> bool {
+        if (ok)                               out.push_back(v);
+        else if (policy == Mismatch::Default) out.push_back(dflt);
+        else if (policy == Mismatch::Fail)    return false;
+        return true;
+    };
+
+    T v {};
+    if (numeric) {
+        for (double d: numbers)
+            if (!push(convert(d, v), v)) return std::nullopt;
+    } else {
+        for (const JsonValue* item: values)
+            if (!push(item && convert(*item, v), v)) return std::nullopt;
+    }
+
+    return out;
+}
+
+template<>
+std::optional<std::vector<double>>
+sjp::JsonValue::to_vector(Mismatch policy, double dflt) const
+{
+    if (get_type() != Type::Array) return std::nullopt;
+    const JsonArray& arr = static_cast<const JsonArray&>(*this);
+
+    if (arr.numeric)
+        return std::vector<double>(arr.numbers.begin(), arr.numbers.end());
+
+    return arr.extract(policy, dflt, overloaded {
+        [](double, double&) { return false; },
+        [](const JsonValue& item, double& v) {
+            if (item.get_type() != Type::Number) return false;
+            v = static_cast<const JsonNumber&>(item).value;
+            return true;
+        }
+    });
+}
+
+// Only numbers without a fractional part that fit into 64 bits qualify.
+static bool to_int64(double d, int64_t& v)
+{
+    if (std::trunc(d) != d) return false;
+    if (d < -0x1p63 || d >= 0x1p63) return false;
+    v = static_cast<int64_t>(d);
+    return true;
+}
+
+template<>
+std::optional<std::vector<int64_t>>
+sjp::JsonValue::to_vector(Mismatch policy, int64_t dflt) const
+{
+    if (get_type() != Type::Array) return std::nullopt;
+    const JsonArray& arr = static_cast<const JsonArray&>(*this);
+
+    return arr.extract(policy, dflt, overloaded {
+        [](double d, int64_t& v) { return to_int64(d, v); },
+        [](const JsonValue& item, int64_t& v) {
+            if (item.get_type() != Type::Number) return false;
+            return to_int64(static_cast<const JsonNumber&>(item).value, v);
+        }
+    });
+}
+
+template<>
+std::optional<std::vector<std::string_view>>
+sjp::JsonValue::to_vector(Mismatch policy, std::string_view dflt) const
+{
+    if (get_type() != Type::Array) return std::nullopt;
+    const JsonArray& arr = static_cast<const JsonArray&>(*this);
+
+    return arr.extract(policy, dflt, overloaded {
+        [](double, std::string_view&) { return false; },
+        [](const JsonValue& item, std::string_view& v) {
+            if (item.get_type() != Type::String) return false;
+            v = static_cast<const JsonString&>(item).value;
+            return true;
+        }
+    });
+}
+
+template<>
+std::optional<std::vector<bool>>
+sjp::JsonValue::to_vector(Mismatch policy, bool dflt) const
+{
+    if (get_type() != Type::Array) return std::nullopt;
+    const JsonArray& arr = static_cast<const JsonArray&>(*this);
+
+    return arr.extract(policy, dflt, overloaded {
+        [](double, bool&) { return false; },
+        [](const JsonValue& item, bool& v) {
+            Type t = item.get_type();
+            if (t != Type::True && t != Type::False) return false;
+            v = t == Type::True;
+            return true;
+        }
+    });
+}
@@ -21,13 +21,30 @@
 #ifndef _JSON_HH_
 #define _JSON_HH_
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <mutex>
 #include <optional>
-#include <queue>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
+#include "buffer.hh"
 #include "common.hh"
+#include "hash.hh"
 #include "io.hh"
+#include "validate.hh"
+
+/* If this is 0, collecting SJP::PARSESTATS is compiled out of the parser and
+ * PARSER::SET_STATS does nothing.
+ */
+#ifndef SJP_STATS
+#define SJP_STATS 1
+#endif
 
 /* There are only 2 classes that make up the API: PARSER and JSON. The user
  * provides an input stream pointer and a logger and the parser will then
@@ -35,8 +52,14 @@
  */
 namespace sjp {
     class Json;
+    class SharedJson;
+    class Pointer;
 
     class Parser;
+    struct ParseError;
+    struct ParseResult;
+    struct ParseStats;
+    struct Limits;
 
     class JsonValue;
     class JsonObject;
@@ -50,36 +73,139 @@ namespace sjp {
 
     enum class Type { Object, Array, String, Number, True, False, Null, None };
 
+    // What JSONVALUE::TO_VECTOR does with items of the wrong type.
+    enum class Mismatch { Skip, Fail, Default };
+
+    /* An object key together with its hash, e.g. computed once when an
+     * SJP::POINTER is compiled. Looking it up in a JSONOBJECT doesn't hash
+     * the key again.
+     */
+    struct HashedKey {
+        std::string_view name;
+        size_t           hash;
+    };
+
+    /* Hash and equality for object keys. Both are transparent, so lookups
+     * work with STD::STRING_VIEWs and HASHEDKEYs without creating a
+     * STD::STRING. Keys are hashed with a random seed (see ``hash.hh''), so
+     * their order in the table differs between processes.
+     */
+    struct KeyHash {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view s) const { return hash_key(s); }
+        size_t operator()(const std::string& s) const
+        { return (*this)(std::string_view { s }); }
+        size_t operator()(const HashedKey& k) const { return k.hash; }
+    };
+
+    struct KeyEqual {
+        using is_transparent = void;
+
+        bool operator()(std::string_view a, std::string_view b) const
+        { return a == b; }
+        bool operator()(const HashedKey& a, std::string_view b) const
+        { return a.name == b; }
+        bool operator()(std::string_view a, const HashedKey& b) const
+        { return a == b.name; }
+    };
+
     static const char* type_to_str(Type);
+    static size_t      heap_bytes(const std::string&);
 }
 
+/* Reading from a parsed JSON object never modifies it: every accessor is
+ * const and lookups don't insert anything. The single exception is indexing a
+ * numeric array, which creates its JSONNUMBERs exactly once (guarded by a
+ * STD::ONCE_FLAG). Thus, any number of threads may read the same document
+ * concurrently without any locking.
+ */
 class sjp::JsonValue {
 protected:
     size_t line_no, char_no;
 
+    /* Moves the children of a container into OUT, which leaves it empty.
+     * That's how FREE_CHILDREN frees a document of any depth with a bounded
+     * amount of stack: every container it deletes has already been emptied.
+     */
+    virtual void take_children(std::vector<JsonValue*>&) {}
+    static void  free_children(JsonValue&);
+
+    // Writes a container and everything in it without recursing.
+    static void serialize_tree(const JsonValue&, OutBuffer&, Style, size_t);
+
+    /* Heap bytes of this value alone. Containers put their children into
+     * the argument, so MEMORY_TREE can add them up without recursing.
+     */
+    virtual size_t own_memory_usage(std::vector<const JsonValue*>&) const
+    { return memory_usage(); }
+    static size_t  memory_tree(const JsonValue&);
+
 public:
     JsonValue(size_t l, size_t c) : line_no { l }, char_no { c } {}
     virtual ~JsonValue(void) {};
 
-    virtual Type get_type(void) = 0;
+    virtual Type get_type(void) const = 0;
 
     // @NOTE: Since DEFAULT_JSON_NONE is still incomplete, we cannot create
     // implementations yet.
-    virtual JsonValue& operator[](size_t) = 0;
-    virtual JsonValue& operator[](const std::string&) = 0;
-
-    virtual std::optional<double>      get_number(void) { return std::nullopt; }
-    virtual std::optional<std::string> get_string(void) { return std::nullopt; }
-    virtual std::optional<bool>        get_bool(void)   { return std::nullopt; }
+    virtual const JsonValue& operator[](size_t) const = 0;
+    virtual const JsonValue& operator[](const std::string&) const = 0;
+
+    virtual std::optional<double>      get_number(void) const
+    { return std::nullopt; }
+    virtual std::optional<std::string> get_string(void) const
+    { return std::nullopt; }
+    virtual std::optional<bool>        get_bool(void) const
+    { return std::nullopt; }
     // @NOTE: We should improve this return value. But right now, it's okay.
-    virtual std::optional<void*>       get_null(void)   { return std::nullopt; }
+    virtual std::optional<void*>       get_null(void) const
+    { return std::nullopt; }
+
+    // Only arrays that exclusively hold numbers return their contents here.
+    virtual std::optional<std::span<const double>> get_numbers(void) const
+    { return std::nullopt; }
+
+    /* Bulk extraction of all items of an array in a single pass. Supported
+     * types are DOUBLE, INT64_T (only numbers without a fractional part),
+     * STD::STRING_VIEW (pointing into this JSON object) and BOOL. Items of
+     * any other type are skipped, replaced by DFLT or make the whole call
+     * fail. Calling this on a non-array always fails.
+     */
+    template<typename T>
+    std::optional<std::vector<T>> to_vector(Mismatch = Mismatch::Skip,
+                                            T dflt = T {}) const;
+
+    virtual size_t      size(void) const { return 1; }
+    virtual std::string type_to_string(void) const
+    { return type_to_str(get_type()); }
+
+    /* Writes this value as JSON text into OUT. D is the current depth, i.e.
+     * how far nested values are indented if the style is pretty.
+     */
+    virtual void serialize(OutBuffer& out, Style, size_t = 0) const
+    { out.put(type_to_str(get_type())); }
+
+    void print(FILE* stream, size_t d = 0) const
+    { OutBuffer out { stream }; serialize(out, Style::Pretty, d); }
 
-    virtual size_t      size(void)           { return 1; }
-    virtual std::string type_to_string(void) { return type_to_str(get_type()); }
-    virtual void        print(FILE* stream, size_t = 0)
-    { fprintf(stream, "%s", type_to_str(get_type())); }
+    /* Heap bytes that this value and everything below it take up, as far as
+     * we asked for them. What the allocator adds on top isn't included.
+     */
+    virtual size_t memory_usage(void) const { return sizeof(*this); }
 };
 
+namespace sjp {
+    template<> std::optional<std::vector<double>>
+    JsonValue::to_vector(Mismatch, double) const;
+    template<> std::optional<std::vector<int64_t>>
+    JsonValue::to_vector(Mismatch, int64_t) const;
+    template<> std::optional<std::vector<std::string_view>>
+    JsonValue::to_vector(Mismatch, std::string_view) const;
+    template<> std::optional<std::vector<bool>>
+    JsonValue::to_vector(Mismatch, bool) const;
+}
+
 class sjp::JsonNone : public JsonValue {
 public:
     friend class sjp::Parser;
@@ -87,16 +213,16 @@ public:
     using JsonValue::JsonValue;
     ~JsonNone(void) {}
 
-    virtual Type       get_type(void)     override { return Type::None; }
-    virtual JsonValue& operator[](size_t) override { return *this; }
-    virtual JsonValue& operator[](const std::string&) override
+    virtual Type       get_type(void) const     override { return Type::None; }
+    virtual const JsonValue& operator[](size_t) const override { return *this; }
+    virtual const JsonValue& operator[](const std::string&) const override
     { return *this; }
 };
 
 /* This is the default value that's referenced whenever the user tries to
  * access a non-existant field on a JSONVALUE.
  */
-static sjp::JsonNone default_json_none(0, 0);
+static const sjp::JsonNone default_json_none(0, 0);
 
 /* For composite types (i.e. JSONOBJECT, JSONARRAY), we don't allow access of
  * the underlying data structures by the user. The same is true for adding
@@ -108,48 +234,91 @@ class sjp::JsonObject : public JsonValue {
     /* To be able to retrieve elements in O(1) time _and_ remember the
      * insertion order, we need additional space.
      */
-    std::unordered_map<std::string, JsonValue*> values         = {};
-    std::vector<std::string>                    names_in_order = {};
+    std::unordered_map<std::string, JsonValue*, KeyHash, KeyEqual> values
+        = {};
+    std::vector<std::string> names_in_order = {};
 
-    void add_value(const std::string&, JsonValue*, const io::Logger&);
+    /* Gives false if there already is a member called NAME. Then, the value
+     * is freed and NAME isn't moved from.
+     */
+    bool add_value(std::string&&, JsonValue*);
+
+    virtual void take_children(std::vector<JsonValue*>&) override;
+    virtual size_t
+    own_memory_usage(std::vector<const JsonValue*>&) const override;
 
 public:
     friend class sjp::Parser;
+    friend class sjp::JsonValue; // for SERIALIZE_TREE
 
     using JsonValue::JsonValue;
-    virtual ~JsonObject(void)
-    { for (const std::string& name: names_in_order) delete values[name]; }
+    virtual ~JsonObject(void) { if (!values.empty()) free_children(*this); }
+
+    virtual Type   get_type(void) const override { return Type::Object; }
+    virtual size_t size(void) const     override { return values.size(); }
 
-    virtual Type   get_type(void) override { return Type::Object; }
-    virtual size_t size(void)     override { return values.size(); }
+    virtual const JsonValue& operator[](size_t) const override;
+    virtual const JsonValue& operator[](const std::string&) const override;
+    virtual void serialize(OutBuffer&, Style, size_t = 0) const override;
+    virtual size_t memory_usage(void) const override
+    { return memory_tree(*this); }
 
-    virtual JsonValue& operator[](size_t) override;
-    virtual JsonValue& operator[](const std::string&) override;
-    virtual void       print(FILE* stream, size_t d = 0) override;
+    // Lookup of a key that was hashed up front (see SJP::POINTER).
+    const JsonValue& get(const HashedKey&) const;
 };
 
 class sjp::JsonArray : public JsonValue {
-    std::vector<JsonValue*> values = {};
+    /* As long as an array holds nothing but numbers (e.g. long numeric
+     * series), we keep them in contiguous storage instead of allocating one
+     * JSONNUMBER per element. VALUES is only used for mixed arrays or, if the
+     * user indexes a numeric array with OPERATOR[], filled in lazily. Items
+     * that a projected parse skipped are NULL in VALUES.
+     */
+    std::vector<double>             numbers      = {};
+    mutable std::vector<JsonValue*> values       = {};
+    bool                            numeric      = true;
+    mutable std::once_flag          materialized = {};
+    mutable std::atomic<bool>       has_values   = false; // once materialized
+
+    void add_number(double d) { numbers.push_back(d); }
+    void add_value(JsonValue*);
+    void materialize(void) const;
 
-    void add_value(JsonValue* v) { values.push_back(v); }
+    template<typename T, typename F>
+    std::optional<std::vector<T>> extract(Mismatch, const T&, F) const;
+
+    virtual void take_children(std::vector<JsonValue*>&) override;
+    virtual size_t
+    own_memory_usage(std::vector<const JsonValue*>&) const override;
 
 public:
     friend class sjp::Parser;
+    friend class sjp::JsonValue; // for the bulk extractors and SERIALIZE_TREE
 
     using JsonValue::JsonValue;
-    virtual ~JsonArray(void) { for (JsonValue* n: values) delete n; }
+    virtual ~JsonArray(void) { if (!values.empty()) free_children(*this); }
 
-    virtual Type   get_type(void) override { return Type::Array; }
-    virtual size_t size(void)     override { return values.size(); }
+    virtual Type   get_type(void) const override { return Type::Array; }
+    virtual size_t size(void) const     override
+    { return numeric ? numbers.size() : values.size(); }
 
-    virtual JsonValue& operator[](size_t) override;
-    virtual JsonValue& operator[](const std::string&) override;
-    virtual void       print(FILE* stream, size_t d = 0) override;
+    virtual std::optional<std::span<const double>>
+    get_numbers(void) const override
+    {
+        if (!numeric) return std::nullopt;
+        return std::span<const double> { numbers };
+    }
+
+    virtual const JsonValue& operator[](size_t) const override;
+    virtual const JsonValue& operator[](const std::string&) const override;
+    virtual void serialize(OutBuffer&, Style, size_t = 0) const override;
+    virtual size_t memory_usage(void) const override
+    { return memory_tree(*this); }
 };
 
 class sjp::JsonString : public JsonValue {
     void        add_value(const std::string& s) { value = s; }
-    std::string get_string_copy(void)           { return value; }
+    std::string get_string_copy(void) const     { return value; }
 
 public:
     friend class sjp::Parser;
@@ -163,23 +332,26 @@ public:
     using JsonValue::JsonValue;
     virtual ~JsonString(void) {}
 
-    virtual Type get_type(void) override { return Type::String; }
+    virtual Type get_type(void) const override { return Type::String; }
 
     /* We put "default" implementations on all basic types because it doesn't
      * seem to make sense to use OPERATOR[] on them. If the user wants their
      * values, he needs to use the appropriate accessor.
      */
-    virtual JsonValue& operator[](size_t) override
+    virtual const JsonValue& operator[](size_t) const override
     { return default_json_none; }
 
-    virtual JsonValue& operator[](const std::string&) override
+    virtual const JsonValue& operator[](const std::string&) const override
     { return default_json_none; }
 
-    virtual std::optional<std::string> get_string(void) override
+    virtual std::optional<std::string> get_string(void) const override
     { return this->value; }
 
-    virtual void print(FILE* stream, size_t) override
-    { fprintf(stream, "\"%s\"", value.c_str()); }
+    virtual void serialize(OutBuffer& out, Style, size_t) const override
+    { out.put_string(value); }
+
+    virtual size_t memory_usage(void) const override
+    { return sizeof(*this) + heap_bytes(value); }
 };
 
 class sjp::JsonNumber : public JsonValue {
@@ -193,19 +365,21 @@ public:
     using JsonValue::JsonValue;
     virtual ~JsonNumber(void) {}
 
-    virtual Type get_type(void) override { return Type::Number; }
+    virtual Type get_type(void) const override { return Type::Number; }
 
-    virtual JsonValue& operator[](size_t) override
+    virtual const JsonValue& operator[](size_t) const override
     { return default_json_none; }
 
-    virtual JsonValue& operator[](const std::string&) override
+    virtual const JsonValue& operator[](const std::string&) const override
     { return default_json_none; }
 
-    virtual std::optional<double> get_number(void) override
+    virtual std::optional<double> get_number(void) const override
     { return this->value; }
 
-    virtual void print(FILE* stream, size_t) override
-    { fprintf(stream, "%g", value); }
+    virtual void serialize(OutBuffer& out, Style, size_t) const override
+    { out.put_number(value); }
+
+    virtual size_t memory_usage(void) const override { return sizeof(*this); }
 };
 
 class sjp::JsonTrue : public JsonValue {
@@ -217,15 +391,16 @@ public:
     using JsonValue::JsonValue;
     virtual ~JsonTrue(void) {}
 
-    virtual Type get_type(void) override { return Type::True; }
+    virtual Type get_type(void) const override { return Type::True; }
+    virtual size_t memory_usage(void) const override { return sizeof(*this); }
 
-    virtual JsonValue& operator[](size_t) override
+    virtual const JsonValue& operator[](size_t) const override
     { return default_json_none; }
 
-    virtual JsonValue& operator[](const std::string&) override
+    virtual const JsonValue& operator[](const std::string&) const override
     { return default_json_none; }
 
-    virtual std::optional<bool> get_bool(void) override
+    virtual std::optional<bool> get_bool(void) const override
     { return this->value; }
 };
 
@@ -241,15 +416,16 @@ public:
     using JsonValue::JsonValue;
     virtual ~JsonFalse(void) {}
 
-    virtual Type get_type(void) override { return Type::False; }
+    virtual Type get_type(void) const override { return Type::False; }
+    virtual size_t memory_usage(void) const override { return sizeof(*this); }
 
-    virtual JsonValue& operator[](size_t) override
+    virtual const JsonValue& operator[](size_t) const override
     { return default_json_none; }
 
-    virtual JsonValue& operator[](const std::string&) override
+    virtual const JsonValue& operator[](const std::string&) const override
     { return default_json_none; }
 
-    virtual std::optional<bool> get_bool(void) override
+    virtual std::optional<bool> get_bool(void) const override
     { return this->value; }
 };
 
@@ -265,15 +441,16 @@ public:
     using JsonValue::JsonValue;
     virtual ~JsonNull(void) {}
 
-    virtual Type get_type(void) override { return Type::Null; }
+    virtual Type get_type(void) const override { return Type::Null; }
+    virtual size_t memory_usage(void) const override { return sizeof(*this); }
 
-    virtual JsonValue& operator[](size_t) override
+    virtual const JsonValue& operator[](size_t) const override
     { return default_json_none; }
 
-    virtual JsonValue& operator[](const std::string&) override
+    virtual const JsonValue& operator[](const std::string&) const override
     { return default_json_none; }
 
-    virtual std::optional<void*> get_null(void) override
+    virtual std::optional<void*> get_null(void) const override
     { return nullptr; }
 };
 
@@ -287,21 +464,189 @@ public:
 
     // @TODO: Should we implement a deep copy of a JSON object?
     Json(const Json&) = delete;
-    Json(Json&&)      = delete;
     Json& operator=(const Json&) = delete;
-    Json& operator=(Json&&)      = delete;
 
-    JsonValue& operator[](size_t i) { return (*root)[i]; }
-    JsonValue& operator[](const std::string& n) { return (*root)[n]; }
+    /* Moving hands over the root. A moved-from JSON object is empty, i.e.
+     * every access gives JSONNONE.
+     */
+    Json(Json&& other) noexcept : root { other.root } { other.root = nullptr; }
+    Json& operator=(Json&& other) noexcept
+    {
+        if (this != &other) {
+            delete root;
+            root = other.root;
+            other.root = nullptr;
+        }
+        return *this;
+    }
+
+    // Everything the document takes up on the heap.
+    size_t memory_usage(void) const { return root ? root->memory_usage() : 0; }
+
+    const JsonValue& get_root(void) const
+    { return root ? *root : static_cast<const JsonValue&>(default_json_none); }
 
-    void print(FILE* stream) { root->print(stream); fprintf(stream, "\n"); }
+    const JsonValue& operator[](size_t i) const
+    { return root ? (*root)[i] : default_json_none; }
+    const JsonValue& operator[](const std::string& n) const
+    { return root ? (*root)[n] : default_json_none; }
+
+    void serialize(OutBuffer& out, Style style) const
+    { if (root) root->serialize(out, style); }
+
+    void print(FILE* stream, Style style = Style::Pretty) const
+    { OutBuffer out { stream }; serialize(out, style); out.put('\n'); }
+    void print(int fd, Style style = Style::Pretty) const
+    { OutBuffer out { fd }; serialize(out, style); out.put('\n'); }
+
+    std::string to_string(Style style = Style::Compact) const
+    {
+        std::string s {};
+        { OutBuffer out { s }; serialize(out, style); }
+        return s;
+    }
+};
+
+/* A cheap, copyable handle to a parsed JSON object that is never modified
+ * again. All copies share the same document, which is freed when the last
+ * handle goes away. The reference count is atomic, so handles may be copied
+ * to and dropped on any number of threads. Construction costs a single
+ * allocation that holds both the count and the document.
+ */
+class sjp::SharedJson {
+    struct Block {
+        std::atomic<size_t> refs;
+        Json                json;
+
+        Block(Json&& j) : refs { 1 }, json { std::move(j) } {}
+    };
+    Block* block = nullptr;
+
+    void release(void)
+    {
+        if (block && block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete block;
+        block = nullptr;
+    }
+
+public:
+    SharedJson(Json&& json) : block { new Block { std::move(json) } } {}
+    ~SharedJson(void) { release(); }
+
+    SharedJson(const SharedJson& other) noexcept : block { other.block }
+    { if (block) block->refs.fetch_add(1, std::memory_order_relaxed); }
+    SharedJson(SharedJson&& other) noexcept : block { other.block }
+    { other.block = nullptr; }
+    SharedJson& operator=(SharedJson other) noexcept
+    { std::swap(block, other.block); return *this; }
+
+    size_t memory_usage(void) const
+    { return block ? sizeof(Block) + block->json.memory_usage() : 0; }
+
+    size_t use_count(void) const
+    { return block ? block->refs.load(std::memory_order_relaxed) : 0; }
+
+    /* The shared document itself, e.g. to resolve an SJP::POINTER against,
+     * to print it or to hand it to the kernels. A moved-from handle gives an
+     * empty document.
+     */
+    const Json& get(void) const
+    {
+        static const Json empty { nullptr };
+        return block ? block->json : empty;
+    }
+
+    const JsonValue& operator[](size_t i) const
+    { return block ? block->json[i] : default_json_none; }
+    const JsonValue& operator[](const std::string& n) const
+    { return block ? block->json[n] : default_json_none; }
+};
+
+/* Describes why a parse failed. OFFSET is the index of the byte we choked on
+ * within the document (or its length, if it ended too early), just like
+ * SJP::VALIDATE reports it. LINE and COLUMN are what the message says, i.e.
+ * where we were when we noticed. That can be a few bytes past OFFSET, e.g.
+ * at the end of a misspelled literal rather than its start.
+ */
+struct sjp::ParseError {
+    enum class Code {
+        None, UnexpectedEof, UnexpectedChar, InvalidLiteral, InvalidNumber,
+        ReadError, TooManyPaths, TooDeep, DocumentTooLarge, TooManyNodes,
+        StringTooLong, KeyTooLong, NumberTooLong, TooManyMembers,
+    };
+
+    Code        code    = Code::None;
+    size_t      offset  = 0;
+    size_t      line    = 0;
+    size_t      column  = 0;
+    std::string message = {};
+};
+
+// What PARSER::TRY_PARSE gives back. JSON is empty if there was an error.
+struct sjp::ParseResult {
+    Json       json  { nullptr };
+    ParseError error = {};
+
+    bool ok(void) const { return error.code == ParseError::Code::None; }
+    explicit operator bool(void) const { return ok(); }
+};
+
+/* What a parse came across. Values that a projected parse skipped over don't
+ * show up in here. Allocations only cover nodes and the contents of strings
+ * that don't fit into a STD::STRING itself, not the bookkeeping of
+ * containers. Times are wall-clock nanoseconds, and reading the input is also
+ * part of parsing or skipping.
+ */
+struct sjp::ParseStats {
+    size_t                bytes           = 0;
+    std::array<size_t, 8> nodes           = {}; // indexed by TYPE
+    size_t                max_depth       = 0;
+    size_t                string_bytes    = 0; // keys and values, unescaped
+    size_t                escapes         = 0;
+    size_t                numbers         = 0;
+    size_t                allocations     = 0;
+    size_t                allocated_bytes = 0;
+
+    uint64_t total_ns = 0;
+    uint64_t read_ns  = 0;
+    uint64_t skip_ns  = 0;
+
+    size_t count(Type t) const { return nodes[static_cast<size_t>(t)]; }
+};
+
+/* Caps on how much work a single parse may do, e.g. for input from producers
+ * we don't trust. As soon as one of them is exceeded, the parse fails with
+ * the matching error code and doesn't read any further. Lengths are in
+ * bytes of input, so escapes count as written (`\u0041' is six bytes, even
+ * though we don't add anything for it). Except for BYTES, values that a
+ * projected parse skips don't count.
+ */
+struct sjp::Limits {
+    static constexpr size_t NONE = SIZE_MAX;
+
+    size_t bytes         = NONE; // of the whole document
+    size_t depth         = MAX_VALIDATE_DEPTH; // see ``validate.hh''
+    size_t nodes         = NONE; // including numbers in numeric arrays
+    size_t string_length = NONE;
+    size_t key_length    = NONE;
+    size_t number_length = NONE; // of the literal, as written
+    size_t members       = NONE; // per object, duplicates included
 };
 
 class sjp::Parser {
     // @NOTE: We don't own these pointers and don't free them.
     FILE* in_stream = nullptr;
     const io::Logger* logger = nullptr; // we need a pointer to be able to copy
-    std::queue<char> unget_queue = {};
+
+    /* IN_STREAM is read in blocks of BLOCK_SIZE bytes. BUF[POS, LEN) is what
+     * we haven't consumed yet. Having the input in memory lets us skip over
+     * whole runs of it at once instead of going char by char.
+     */
+    static constexpr size_t BLOCK_SIZE = 1 << 16;
+    std::vector<char> buf = {};
+    size_t pos  = 0;
+    size_t len  = 0;
+    size_t base = 0; // how many bytes of IN_STREAM came before BUF
 
     // @NOTE: Users cannot default-construct, but we need to when copying.
     Parser(void) {}
@@ -327,12 +672,13 @@ class sjp::Parser {
         { line_no++; prev_line_len = char_no; char_no = 0; }
     } cursor = {};
 
+    bool refill(void);
+    void advance(size_t);
     [[nodiscard]] char get_char(void);
-    [[nodiscard]] char peek_char(size_t = 1);
+    [[nodiscard]] char peek_char(void);
     void eat_char(void);
     void match_char(char);
     void match_string(const char*);
-    void unget_char(char);
     void ws(void);
 
     /* @TODO: We don't implement anything but ASCII streams right now. This
@@ -341,13 +687,121 @@ class sjp::Parser {
      */
     char get_unicode_from_hex(void);
 
-    JsonValue* json(void);
-    JsonValue* element(void);
-    JsonValue* value(void);
-    JsonValue* object(void);
-    JsonValue* array(void);
+    /* While parsing with a set of paths, this tells us which of them (as a
+     * bit mask into PATHS) lead through the current value, and how deep in
+     * the document we are. If ALL is set, the value is wanted as a whole.
+     * ENDS are the paths that point at exactly this value.
+     */
+    struct Projection {
+        bool     all   = true;
+        uint64_t live  = 0;
+        size_t   depth = 0;
+        uint64_t ends  = 0;
+    };
+    const Pointer* paths = nullptr; // only set during a projected parse
+
+    /* Paths whose values we've completely read. Once all WANTED paths are
+     * FOUND, a parse that may stop early sets STOPPED and every caller
+     * returns right away without reading any more input.
+     */
+    uint64_t wanted     = 0;
+    uint64_t found      = 0;
+    bool     stop_early = false;
+    bool     stopped    = false;
+
+    /* The first error of a parse. Unless RECOVERABLE is set, there is no
+     * second one since the logger ends the process.
+     */
+    bool       recoverable = false;
+    ParseError last_error  = {};
+
+    /* ERROR blames the byte we've read last (or the end of the input, if
+     * that's what we ran into), ERROR_AT the byte at the given offset.
+     */
+    void error(ParseError::Code, const char*, ...)
+        __attribute__((format(printf, 3, 4)));
+    void error_at(size_t, ParseError::Code, const char*, ...)
+        __attribute__((format(printf, 4, 5)));
+    void verror(size_t, ParseError::Code, const char*, va_list);
+
+    /* Warnings about the input are collected per document instead of being
+     * logged right away. For every kind, we only keep the first one and how
+     * often it came up. PARSE_ROOT reports that once at the end. Offsets
+     * are within the document, like those of errors.
+     */
+    enum class Warning { DuplicateKey, InvalidEscape };
+    struct WarningSummary {
+        size_t      count  = 0;
+        size_t      line   = 0;
+        size_t      column = 0;
+        size_t      offset = 0;
+        std::string what   = {};
+    };
+    std::array<WarningSummary, 2> warnings = {};
+
+    void warn(Warning, size_t, size_t, size_t, std::string_view);
+    void report_warnings(void);
+
+    /* Everything that touches STATS goes through WITH_STATS, so it's gone
+     * entirely if SJP_STATS is 0.
+     */
+    ParseStats* stats = nullptr;
+
+    template<typename F> void with_stats(F f)
+    { if constexpr (SJP_STATS) { if (stats) f(*stats); } }
+    void count_node(void);
+    template<typename T> T* make_node(size_t, size_t);
+    uint64_t now(void) const;
+    bool failed(void) const
+    { return last_error.code != ParseError::Code::None; }
+
+    void       begin(bool);
+    Projection project(std::span<const Pointer>, bool);
+    JsonValue* parse_root(Projection);
+    void       found_value(Projection);
+    Projection descend(Projection, std::string_view);
+    Projection descend(Projection, size_t);
+    void       skip_value(void);
+
+    /* Containers that we've opened but not yet closed, innermost last. Each
+     * frame has all we need to go on with its container once the current
+     * item is complete: for objects, that's the item's key and where it
+     * started (in case it's a duplicate), and for arrays the item's index.
+     * Thus, nesting doesn't cost any C++ stack and LIMITS.DEPTH is the only
+     * limit. FRAMES is kept between parses, so it's allocated only once.
+     */
+    struct Frame {
+        JsonValue*  node;
+        Projection  proj;
+        bool        object;
+        size_t      index  = 0; // of the next item, objects count members
+        std::string key    = {};
+        size_t      line   = 0;
+        size_t      column = 0;
+        size_t      offset = 0;
+    };
+    std::vector<Frame> frames = {};
+
+    /* START is where the current document began in IN_STREAM, NODES counts
+     * the values we've built since, both for checking them against LIMITS.
+     */
+    Limits limits = {};
+    size_t start  = 0;
+    size_t nodes  = 0;
+
+    // Where the next byte that we read is, within the current document.
+    size_t doc_offset(void) const { return base+pos - start; }
+
+    JsonValue* json(Projection);
+    JsonValue* element(Projection);
+    JsonValue* value(Projection);
+    bool       open(bool, Projection, JsonValue*&);
+    bool       next_item(bool, Projection&);
+    void       attach(Frame&, JsonValue*);
     JsonValue* string(void);
+    void       string_value(std::string&, bool);
     JsonValue* number(void);
+    double     number_value(void);
     JsonValue* true_(void);
     JsonValue* false_(void);
     JsonValue* null(void);
@@ -369,11 +823,54 @@ public:
 
         swap(fst.in_stream, snd.in_stream);
         swap(fst.logger, snd.logger);
-        swap(fst.unget_queue, snd.unget_queue);
+        swap(fst.buf, snd.buf);
+        swap(fst.pos, snd.pos);
+        swap(fst.len, snd.len);
+        swap(fst.base, snd.base);
         swap(fst.cursor, snd.cursor);
+        swap(fst.stats, snd.stats);
+        swap(fst.frames, snd.frames);
+        swap(fst.limits, snd.limits);
     }
 
+    static constexpr size_t MAX_PATHS = 64;
+
     Json parse(void);
+
+    /* Only builds the values that the given paths point at (including all of
+     * their children) and skips everything else. Up to MAX_PATHS paths are
+     * supported. Array items that are skipped leave an empty slot behind,
+     * which behaves like a missing value. Thus, items keep their positions.
+     * If STOP_EARLY is set, we return as soon as all paths have been found,
+     * without reading (or checking) the rest of the input.
+     */
+    Json parse(std::span<const Pointer>, bool stop_early = true);
+
+    /* Like PARSE, but errors in the input don't end the process. Instead,
+     * we stop at the first one and hand it back together with an empty
+     * JSON object. Everything that was built up to that point is freed.
+     */
+    ParseResult try_parse(void);
+    ParseResult try_parse(std::span<const Pointer>, bool stop_early = true);
+
+    /* Makes the parser read from a new stream, forgetting about the rest of
+     * the old one. That's what lets a parser carry on after a failed parse.
+     */
+    void reset(FILE*);
+
+    /* Every following parse fills in STATS (if not NULL), which must outlive
+     * these parses.
+     */
+    void set_stats(ParseStats* s) { stats = s; }
+
+    // Every following parse fails as soon as it exceeds one of L.
+    void set_limits(const Limits& l) { limits = l; }
+    const Limits& get_limits(void) const { return limits; }
+
+    /* Containers nested deeper than D make a parse fail. Since we don't
+     * recurse, any depth works, this only bounds the memory spent on it.
+     */
+    void set_max_depth(size_t d) { limits.depth = d; }
 };
 
 static const char* sjp::type_to_str(Type type)
@@ -389,6 +886,13 @@ static const char* sjp::type_to_str(Type type)
     case Type::None:   return "none";
     default: assert(!"incomplete switch in `sjp::type_to_str()'");
     }
+    return "unknown"; // only reached with NDEBUG
+}
+
+// Heap bytes of a string's contents, nothing if it fits into the SSO buffer.
+static size_t sjp::heap_bytes(const std::string& s)
+{
+    return s.capacity() > std::string {}.capacity() ? s.capacity()+1 : 0;
 }
 
 #endif /* _JSON_HH_ */
@@ -0,0 +1,236 @@
+/* Implementation of SJP::VALIDATE, see ``validate.hh''. The grammar is the
+ * same one that SJP::PARSER follows, but we walk it iteratively and only
+ * remember what kind of container we're in.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <array>
+#include <cstring>
+
+#include "scan.hh"
+#include "validate.hh"
+
+/* All helpers take the current position P by reference and advance it over
+ * what they've accepted. On failure, they return why and leave P at the
+ * offending byte. NULL means everything was fine.
+ */
+using Error = const char*;
+
+static bool is_digit(char c)
+{
+    return '0' <= c && c <= '9';
+}
+
+static bool is_hex(char c)
+{
+    return is_digit(c) || ('a' <= c && c <= 'f') || ('A' <= c && c <= 'F');
+}
+
+static void ws(const char*& p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        p++;
+}
+
+// A single multi-byte UTF-8 sequence, P is at its first byte.
+static Error utf8(const char*& p, const char* end)
+{
+    unsigned char c = static_cast<unsigned char>(*p);
+    size_t   n;
+    uint32_t cp, min;
+
+    if      (c >= 0xc2 && c <= 0xdf) { n = 1; cp = c & 0x1f; min = 0x80;    }
+    else if (c >= 0xe0 && c <= 0xef) { n = 2; cp = c & 0x0f; min = 0x800;   }
+    else if (c >= 0xf0 && c <= 0xf4) { n = 3; cp = c & 0x07; min = 0x10000; }
+    else return "invalid UTF-8 lead byte";
+
+    if (static_cast<size_t>(end-p) <= n) return "truncated UTF-8 sequence";
+    for (size_t i = 1; i <= n; i++) {
+        unsigned char b = static_cast<unsigned char>(p[i]);
+        if ((b & 0xc0) != 0x80) return "invalid UTF-8 continuation byte";
+        cp = (cp << 6) | (b & 0x3f);
+    }
+
+    if (cp < min)                     return "overlong UTF-8 sequence";
+    if (cp >= 0xd800 && cp <= 0xdfff) return "UTF-8 encoded surrogate";
+    if (cp > 0x10ffff)                return "code point out of range";
+
+    p += n+1;
+    return nullptr;
+}
+
+// P is at the opening quote.
+static Error string(const char*& p, const char* end)
+{
+    p++;
+    for (;;) {
+        // Anything that isn't plain ASCII string content needs a closer look.
+        p += sjp::find_special(p, end-p, sjp::SCAN_QUOTE | sjp::SCAN_BACKSLASH |
+                               sjp::SCAN_CONTROL | sjp::SCAN_NON_ASCII);
+        if (p == end) return "unterminated string";
+
+        switch (*p) {
+        case '"':
+            p++;
+            return nullptr;
+        case '\\':
+            if (++p == end) return "unterminated string";
+            switch (*p) {
+            case '"': case '\\': case '/':
+            case 'b': case 'f': case 'n': case 'r': case 't':
+                p++;
+                break;
+            case 'u':
+                p++;
+                for (size_t i = 0; i < 4; i++, p++)
+                    if (p == end || !is_hex(*p)) return "invalid \\u escape";
+                break;
+            default:
+                return "invalid escape sequence";
+            }
+            break;
+        default:
+            if (static_cast<unsigned char>(*p) < 0x20)
+                return "control character in string";
+            if (Error err = utf8(p, end)) return err;
+        }
+    }
+}
+
+static Error number(const char*& p, const char* end)
+{
+    if (*p == '-') p++;
+
+    if (p == end || !is_digit(*p)) return "expected a digit";
+    if (*p++ != '0')
+        while (p < end && is_digit(*p)) p++;
+
+    if (p < end && *p == '.') {
+        p++;
+        if (p == end || !is_digit(*p))
+            return "expected a digit after decimal point";
+        while (p < end && is_digit(*p)) p++;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) p++;
+        if (p == end || !is_digit(*p)) return "expected a digit in exponent";
+        while (p < end && is_digit(*p)) p++;
+    }
+
+    return nullptr;
+}
+
+static Error literal(const char*& p, const char* end, std::string_view lit)
+{
+    if (static_cast<size_t>(end-p) < lit.size() ||
+        memcmp(p, lit.data(), lit.size()) != 0)
+        return "invalid literal";
+    p += lit.size();
+    return nullptr;
+}
+
+// Any value but a container.
+static Error scalar(const char*& p, const char* end)
+{
+    if (p == end) return "expected value";
+
+    switch (*p) {
+    case '"': return string(p, end);
+    case 't': return literal(p, end, "true");
+    case 'f': return literal(p, end, "false");
+    case 'n': return literal(p, end, "null");
+    default:
+        if (*p == '-' || is_digit(*p)) return number(p, end);
+        return "expected value";
+    }
+}
+
+// An object member's name and the colon, up to where its value starts.
+static Error key(const char*& p, const char* end)
+{
+    ws(p, end);
+    if (p == end || *p != '"') return "expected string";
+    if (Error err = string(p, end)) return err;
+
+    ws(p, end);
+    if (p == end || *p != ':') return "expected `:'";
+    p++;
+    return nullptr;
+}
+
+/* Whenever we open a container, we push whether it's an object and go on with
+ * its first item. After every complete value, we either continue with the
+ * next item of the innermost container or close it.
+ */
+sjp::Validation sjp::validate(std::string_view input)
+{
+    const char* begin = input.data();
+    const char* end   = begin + input.size();
+    const char* p     = begin;
+
+    std::array<bool, MAX_VALIDATE_DEPTH> object;
+    size_t depth = 0;
+
+    auto fail = [&p, begin](Error why) -> Validation {
+        return Validation { static_cast<size_t>(p-begin), why };
+    };
+
+    bool want_value = true;
+    for (;;) {
+        if (want_value) {
+            ws(p, end);
+            if (p < end && (*p == '{' || *p == '[')) {
+                // Empty containers count, too, just like in SJP::PARSER.
+                if (depth == MAX_VALIDATE_DEPTH)
+                    return fail("nesting too deep");
+                bool obj = *p++ == '{';
+                ws(p, end);
+                if (p < end && *p == (obj ? '}' : ']')) {
+                    p++;
+                } else {
+                    object[depth++] = obj;
+                    if (obj)
+                        if (Error err = key(p, end)) return fail(err);
+                    continue;
+                }
+            } else if (Error err = scalar(p, end)) {
+                return fail(err);
+            }
+        }
+
+        ws(p, end);
+        if (depth == 0) break;
+
+        bool obj = object[depth-1];
+        if (p < end && *p == ',') {
+            p++;
+            if (obj)
+                if (Error err = key(p, end)) return fail(err);
+            want_value = true;
+        } else if (p < end && *p == (obj ? '}' : ']')) {
+            p++;
+            depth--;
+            want_value = false;
+        } else {
+            return fail(obj ? "expected `,' or `}'" : "expected `,' or `]'");
+        }
+    }
+
+    if (p != end) return fail("expected end of input");
+    return Validation {};
+}
@@ -0,0 +1,54 @@
+/* SJP::VALIDATE checks whether a buffer holds well-formed JSON without
+ * building a JSON object. It is meant for rejecting bad input early, where a
+ * full parse would be wasted work.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef _VALIDATE_HH_
+#define _VALIDATE_HH_
+
+#include <string_view>
+
+#include "common.hh"
+
+namespace sjp {
+    struct Validation;
+
+    /* Containers nested deeper than this (empty ones included) are rejected
+     * by SJP::VALIDATE, just like by a parser with the default SJP::LIMITS.
+     */
+    constexpr size_t MAX_VALIDATE_DEPTH = 1024;
+
+    /* Checks the input against the JSON grammar. That's a bit stricter
+     * than what SJP::PARSER accepts: strings must be valid UTF-8 without raw
+     * control characters and only contain the escapes from the spec. Nothing
+     * is allocated, open containers are tracked on a fixed stack.
+     */
+    Validation validate(std::string_view);
+}
+
+/* If the input isn't valid, OFFSET is the byte at which we noticed and ERROR
+ * says what's wrong. ERROR is a static string, so nothing has to be freed.
+ */
+struct sjp::Validation {
+    size_t      offset = 0;
+    const char* error  = nullptr;
+
+    bool ok(void) const { return !error; }
+    explicit operator bool(void) const { return ok(); }
+};
+
+#endif /* _VALIDATE_HH_ */
@@ -0,0 +1,135 @@
+/* Implementation of SJP::WRITER, see ``writer.hh''. The layout of pretty
+ * output matches what JSON::PRINT produces.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <charconv>
+
+#include "writer.hh"
+
+// Emits whatever separates the next value from the previous one.
+bool sjp::Writer::before_value(void)
+{
+    if (failed) return false;
+
+    if (depth == 0) {
+        if (done) return fail("only one top-level value is allowed");
+        return true;
+    }
+
+    Frame& top = stack[depth-1];
+    if (top.object) {
+        if (!top.has_key) return fail("object member without a key");
+        top.has_key = false;
+        return true;
+    }
+
+    if (top.count++ > 0) out.put(',');
+    if (style == Style::Pretty) out.newline(depth);
+    return true;
+}
+
+bool sjp::Writer::open(bool object, char c)
+{
+    if (depth == MAX_DEPTH) return fail("nesting too deep");
+    if (!before_value())    return false;
+
+    stack[depth++] = Frame { object, false, 0 };
+    out.put(c);
+    return true;
+}
+
+bool sjp::Writer::close(bool object, char c)
+{
+    if (failed) return false;
+    if (depth == 0 || stack[depth-1].object != object)
+        return fail(object ? "end_object() without an open object"
+                           : "end_array() without an open array");
+
+    Frame& top = stack[depth-1];
+    if (top.has_key) return fail("object member without a value");
+
+    depth--;
+    if (top.count > 0 && style == Style::Pretty) out.newline(depth);
+    out.put(c);
+    if (depth == 0) done = true;
+    return true;
+}
+
+bool sjp::Writer::key(std::string_view k)
+{
+    if (failed) return false;
+    if (depth == 0 || !stack[depth-1].object)
+        return fail("key() outside of an object");
+
+    Frame& top = stack[depth-1];
+    if (top.has_key) return fail("two keys in a row");
+
+    if (top.count++ > 0) out.put(',');
+    if (style == Style::Pretty) out.newline(depth);
+    out.put_string(k);
+    out.put(style == Style::Pretty ? ": " : ":");
+    top.has_key = true;
+    return true;
+}
+
+// Every scalar is written the same way, only the text differs.
+template<typename F>
+bool sjp::Writer::scalar(F write)
+{
+    if (!before_value()) return false;
+    write();
+    if (depth == 0) done = true;
+    return true;
+}
+
+bool sjp::Writer::value(double d)
+{
+    return scalar([this, d](void) { out.put_number(d); });
+}
+
+bool sjp::Writer::value(bool b)
+{
+    return scalar([this, b](void) { out.put(b ? "true" : "false"); });
+}
+
+bool sjp::Writer::value(std::string_view s)
+{
+    return scalar([this, s](void) { out.put_string(s); });
+}
+
+bool sjp::Writer::null(void)
+{
+    return scalar([this](void) { out.put("null"); });
+}
+
+bool sjp::Writer::integer(int64_t i)
+{
+    return scalar([this, i](void) {
+        char tmp[24];
+        char* end = std::to_chars(tmp, tmp+sizeof(tmp), i).ptr;
+        out.put(tmp, static_cast<size_t>(end-tmp));
+    });
+}
+
+bool sjp::Writer::integer(uint64_t i)
+{
+    return scalar([this, i](void) {
+        char tmp[24];
+        char* end = std::to_chars(tmp, tmp+sizeof(tmp), i).ptr;
+        out.put(tmp, static_cast<size_t>(end-tmp));
+    });
+}
@@ -0,0 +1,104 @@
+/* SJP::WRITER produces JSON text without building a JSON object first. The
+ * caller opens and closes containers, names object members and writes
+ * values, and the writer emits them straight into an SJP::OUTBUFFER.
+ *
+ * Simple-JSON-Parser (SJP) Copyright (C) 2021 Daniel Schuette
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef _WRITER_HH_
+#define _WRITER_HH_
+
+#include <array>
+#include <concepts>
+#include <string_view>
+
+#include "buffer.hh"
+#include "common.hh"
+
+namespace sjp {
+    class Writer;
+}
+
+/* The writer checks that calls are well-nested (e.g. a key is followed by a
+ * value, END_ARRAY closes an array, there is only a single top-level value).
+ * The first invalid call puts the writer into a failed state: it returns
+ * false and every following call is ignored. Nothing is allocated per value,
+ * open containers live on a small fixed stack.
+ */
+class sjp::Writer {
+public:
+    static constexpr size_t MAX_DEPTH = 256;
+
+private:
+    struct Frame {
+        bool   object  = false;
+        bool   has_key = false; // an object member is waiting for its value
+        size_t count   = 0;
+    };
+
+    OutBuffer&                    out;
+    Style                         style;
+    std::array<Frame, MAX_DEPTH>  stack  = {};
+    size_t                        depth  = 0;
+    bool                          done   = false;
+    const char*                   failed = nullptr;
+
+    bool fail(const char* why) { if (!failed) failed = why; return false; }
+    bool before_value(void);
+    bool open(bool object, char c);
+    bool close(bool object, char c);
+    bool integer(int64_t);
+    bool integer(uint64_t);
+
+    template<typename F> bool scalar(F);
+
+public:
+    Writer(OutBuffer& o, Style s = Style::Compact) : out { o }, style { s } {}
+    ~Writer(void) {}
+
+    Writer(const Writer&) = delete;
+    Writer(Writer&&)      = delete;
+    Writer& operator=(const Writer&) = delete;
+    Writer& operator=(Writer&&)      = delete;
+
+    bool begin_object(void) { return open(true, '{'); }
+    bool end_object(void)   { return close(true, '}'); }
+    bool begin_array(void)  { return open(false, '['); }
+    bool end_array(void)    { return close(false, ']'); }
+
+    bool key(std::string_view);
+
+    bool value(double);
+    bool value(bool);
+    bool value(std::string_view);
+    bool value(const char* s) { return value(std::string_view { s }); }
+    bool null(void);
+
+    // Without this, integers would be ambiguous between DOUBLE and BOOL.
+    template<std::integral T>
+    bool value(T i)
+    {
+        if constexpr (std::is_signed_v<T>) return integer(int64_t { i });
+        else                               return integer(uint64_t { i });
+    }
+
+    // True once exactly one complete top-level value has been written.
+    bool complete(void) const { return !failed && done && depth == 0; }
+
+    // NULL if everything went fine, otherwise what went wrong first.
+    const char* error(void) const { return failed; }
+};
+
+#endif /* _WRITER_HH_ */